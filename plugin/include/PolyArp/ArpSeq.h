@@ -1,32 +1,36 @@
 
 #pragma once
 #include "PolyArp/Arpeggiator.h"
+#include "PolyArp/CircularBuffer.h"
 #include "PolyArp/PolyTrack.h"
 #include "PolyArp/KeyboardState.h"
 #include "PolyArp/VoiceLimiter.h"
-#include <juce_audio_devices/juce_audio_devices.h>  // juce::MidiMessageCollector
+#include <juce_audio_basics/juce_audio_basics.h>  // juce::MidiBuffer
+#include <array>
+#include <atomic>
+#include <bit>
 
 #define BPM_DEFAULT 120
 #define BPM_MAX 240
 #define BPM_MIN 30
 
-#define TICKS_PER_16TH 24  // 96 ppqn, TODO: constexpr
 #define SWING_MAX 0.75
 
 #define POLYPHONY 10
 
+#define COMMAND_QUEUE_SIZE 256
+#define OUTPUT_QUEUE_SIZE 1024  // events
+#define STEP_CHANGE_QUEUE_SIZE 128
+
 namespace Sequencer {
 
 // this classes is responsible for time translation and sending midi messages
+// all time stamps handled by this class are in samples since prepareToPlay
 
 // TODO: make sure all private variables properly initialized
-static double GetSystemTime() {
-  return juce::Time::getMillisecondCounterHiRes() * 0.001;
-}
-
 class ArpSeq {
 public:
-  ArpSeq(juce::MidiMessageCollector& midiCollector)
+  ArpSeq()
       : bpm_(BPM_DEFAULT),
         swing_(0.0),
         // sequencerShouldPlay_(false),
@@ -38,30 +42,39 @@ public:
         seqPauseTime_(0.0),
         arpOn_(false),
         arpStartTime_(0.0),
-        timeSinceStart_(0.0),
+        clockSource_(ClockSource::Internal),
+        hostIsPlaying_(false),
+        hostTicks_(0.0),
+        nextSongTick_(0),
+        sampleRate_(44100.0),
+        blockStartTime_(0),
+        blockOffset_(0),
+        samplesSinceTick_(0.0),
         hold_(false),
         arpeggiator_(1),
         sequencer_(1, voiceLimiter_, 16),
         voiceLimiter_(10),
-        midiCollector_(midiCollector) {
+        recordingPass_(0),
+        recordedSteps_(0),
+        outputMaxDepth_(0),
+        outputOverflows_(0),
+        sequencerStepIndex_(0) {
+    // time translation: messages rendered by a part are due at the tick being
+    // processed, which is the current sample offset of the block, plus the
+    // fraction of a tick they carry
     arpeggiator_.sendMidiMessage = [this](juce::MidiMessage message) {
-      // time translation
-      // int tick = static_cast<int>(message.getTimeStamp());
-      // double real_time_stamp = arpStartTime_ + getOneTickTime() * tick;
-      double real_time_stamp = GetSystemTime();
-      sendMidiMessageToOuput(message.withTimeStamp(real_time_stamp));
+      sendMidiMessageToOuput(
+          message.withTimeStamp(getPartMessageTime(message)));
     };
     // MARK: seq out
     sequencer_.sendMidiMessage = [this](juce::MidiMessage message) {
-      // time translation (TODO: just use system time?)
-      // int tick = static_cast<int>(message.getTimeStamp());
-      // double real_time_stamp = seqStartTime_ + getOneTickTime() * tick;
-      double real_time_stamp = GetSystemTime();
-      message.setTimeStamp(real_time_stamp);
+      message.setTimeStamp(getPartMessageTime(message));
 
       sendMidiMessageToVoiceLimiter(message, Priority::Sequencer);
     };
 
+    sequencer_.onStep = [this](int) { applyPendingPattern(); };
+
     // MARK: arp seq sync
     // sequencer_.onStep = [this](int) {
     //   if (arpOn_) {
@@ -76,12 +89,103 @@ public:
     // };
   }
 
+  // MARK: commands
+  // every change coming from another thread (the editor) is queued here and
+  // applied by the audio thread at the start of its next block, so the engine
+  // is only ever touched by the audio thread and nobody waits on a lock
+  enum class Command {
+    SequencerPlay,
+    SequencerRest,
+    SequencerArmed,
+    QuantizeRec,
+    KeyTrigger,
+    KeytriggerMode,
+    Hold,
+    Arp,
+    ArpVelocityMode,
+    // continuous values, only the latest one matters (keep these last)
+    Bpm,
+    Swing,
+    NumVoices,
+  };
+
+  // call from one non-audio thread only, bools are sent as 0/1 and enums as
+  // their index. return false (and drop the command) if the queue is full.
+  // continuous values never fail: each one has a single slot that is
+  // overwritten, so dragging a slider can't fill the queue
+  bool sendCommand(Command command, double value) {
+    if (command >= Command::Bpm) {
+      auto slot = static_cast<std::size_t>(command) -
+                  static_cast<std::size_t>(Command::Bpm);
+      latestValues_[slot].store(value, std::memory_order_relaxed);
+      latestValueMask_.fetch_or(1u << slot, std::memory_order_release);
+      return true;
+    }
+    return commands_.push({command, value});
+  }
+
+  // MARK: recorded steps
+  // steps changed by real-time recording or overdub are published once per
+  // block, so the audio thread never calls into the host. the latest version
+  // of a step is always the last one sent
+  struct StepChange {
+    std::uint32_t pass;  // counts up every time recording is armed
+    int index;
+    PolyStep<POLYPHONY> step;
+  };
+
+  // call from one non-audio thread only
+  bool popStepChange(StepChange& change) { return stepChanges_.pop(change); }
+
   enum class KeytriggerMode { LastKey, Transpose, FirstKey };
   void setKeytriggerMode(KeytriggerMode mode) { keytriggerMode_ = mode; }
 
   void setBpm(double BPM) { bpm_ = BPM; }
   double getBpm() const { return bpm_; }
 
+  // Internal: free running at bpm
+  // Host: ticks are derived from the host's song position while it is playing,
+  // its transport starts and stops the sequencer (unless key triggered)
+  enum class ClockSource { Internal, Host };
+  void setClockSource(ClockSource source) { clockSource_ = source; }
+
+  // host transport state at the first sample of the next block
+  // parts are relocated when the host starts, loops or jumps, or whenever their
+  // position drifts away from the song position
+  void setHostPosition(bool isPlaying, double ppqPosition) {
+    if (clockSource_ != ClockSource::Host) {
+      return;
+    }
+
+    if (isPlaying) {
+      double song_ticks = ppqPosition * TICKS_PER_QUARTER;
+      bool relocated =
+          !hostIsPlaying_ || std::abs(song_ticks - hostTicks_) > 0.5;
+
+      hostTicks_ = song_ticks;
+      if (relocated) {
+        nextSongTick_ =
+            static_cast<juce::int64>(std::ceil(getSwungTick(song_ticks)));
+      }
+
+      if (!hostIsPlaying_) {
+        // random arps replay the same way from every transport start
+        arpeggiator_.restartRandom();
+        if (!sequencerKeyTrigger_) {
+          startSequencer(true);
+        }
+      }
+
+      hostIsPlaying_ = true;
+      syncPartsToSong(relocated);
+    } else {
+      if (hostIsPlaying_ && !sequencerKeyTrigger_) {
+        stopSequencer();
+      }
+      hostIsPlaying_ = false;
+    }
+  }
+
   // sequencer
   // not effect if reset is false and seq is already running
   void startSequencer(bool reset) {
@@ -92,15 +196,15 @@ public:
     if (reset) {
       sequencer_.sendNoteOffNow();
       sequencer_.reset();
-      seqStartTime_ = GetSystemTime();
+      seqStartTime_ = now();
     } else {
       // compensate for pause time
-      seqStartTime_ += (GetSystemTime() - seqPauseTime_);
+      seqStartTime_ += (now() - seqPauseTime_);
     }
 
     // sequencerShouldPlay_ = true;
     sequencerIsTicking_ = true;
-    timeSinceStart_ = 0.0;
+    samplesSinceTick_ = 0.0;
 
     // start ticking instantly if arp muted
     // if (arpeggiator_.isMuted()) {
@@ -112,7 +216,8 @@ public:
     // sequencerShouldPlay_ = false;
     sequencerIsTicking_ = false;  // stop ticking immediately
     sequencer_.sendNoteOffNow();
-    seqPauseTime_ = GetSystemTime();
+    applyPendingPattern();
+    seqPauseTime_ = now();
     // sequencer_.moveToGrid();  // to avoid seq and arp out of sync
   }
 
@@ -136,6 +241,9 @@ public:
   void setSequencerRest(bool enabled) { sequencer_.setRest(enabled); }
 
   void setSequencerArmed(bool enabled) {
+    if (enabled && !sequencerArmed_) {
+      ++recordingPass_;
+    }
     sequencerArmed_ = enabled;
     sequencer_.setOverdub(enabled);
   }
@@ -175,9 +283,6 @@ public:
     }
   }
 
-  std::function<void(int step_index, PolyStep<POLYPHONY> step)>
-      notifyProcessorSeqUpdate;
-
   // automatically stopped when all notes are off
   void handleNoteOff(juce::MidiMessage noteOff, bool recordingOn = true) {
     if (hold_) {
@@ -219,15 +324,14 @@ public:
 
     // MARK: realtime rec
     if (recordingOn && sequencerArmed_ && sequencerIsTicking_) {
-      auto new_note = calculateNoteFromNoteOnAndOff(matched_note_on, noteOff);
+      auto new_note = calculateNoteFromNoteOnAndOff(
+          noteOff.getNoteNumber(), matched_note_on, noteOff.getTimeStamp());
       int step_index = noteToStepIndex_[noteOff.getNoteNumber()];
 
       auto step = sequencer_.getStepAtIndex(step_index);
       step.addNote(new_note, static_cast<int>(voiceLimiter_.getNumVoices()));
       sequencer_.setStepAtIndex(step_index, step);
-
-      // notify AudioProcessor of parameter change
-      notifyProcessorSeqUpdate(step_index, step);
+      recordedSteps_ |= std::uint64_t{1} << step_index;
     }
 
     // if (!note_muted) {
@@ -276,46 +380,381 @@ public:
 
   auto& getArp() { return arpeggiator_; }
   auto& getSeq() { return sequencer_; }
+
+  // a whole new sequencer pattern (a loaded state) is swapped in when the
+  // play head reaches the next step, so that the step being played never
+  // mixes the two, or right away if the sequencer is stopped
+  using Pattern = PolyTrack<POLYPHONY>::Pattern;
+  void setSequencerPattern(const Pattern& pattern) {
+    if (sequencerIsTicking_) {
+      pendingPattern_ = pattern;
+      hasPendingPattern_ = true;
+    } else {
+      sequencer_.setPattern(pattern);
+    }
+  }
+
+  // an edited step goes into the pending pattern if there is one, so that
+  // it is not overwritten when the pattern lands
+  void setSequencerStep(int index, const PolyStep<POLYPHONY>& step) {
+    if (hasPendingPattern_) {
+      pendingPattern_.steps[index] = step;
+    } else {
+      sequencer_.setStepAtIndex(index, step);
+    }
+  }
   auto& getVoiceLimiter() { return voiceLimiter_; }
 
   void setSwing(double amount) { swing_ = amount; }
 
-  // deltaTime is in seconds, call this frequently, preferably over 1kHz
-  void process(double deltaTime) {
-    timeSinceStart_ += deltaTime;
-    double one_tick_time_with_swing = getOneTickTimeWithSwing();
-
-    if (timeSinceStart_ >= one_tick_time_with_swing) {
-      // worry: if seq is stopped when arp is running, they might be out of sync
-      if (sequencerIsTicking_) {
-        int current_index = sequencer_.getCurrentStepIndex();
-
-        // MARK: rest
-        // if (sequencerRest_) {
-        //   if (sequencerArmed_) {
-        //     sequencer_.resetStepAtIndex(current_index);
-        //   }
-        // }
-
-        sequencer_.tick();  // overdub happens inside
-
-        // in case overdub changes a step
-        if (sequencerArmed_) {
-          notifyProcessorSeqUpdate(current_index,
-                                   sequencer_.getStepAtIndex(current_index));
-        }
+  // output queue statistics, safe to read from any thread
+  // the deepest the queue has been and the number of events dropped because
+  // it was full, since construction or resetOutputStats()
+  int getOutputMaxDepth() const {
+    return outputMaxDepth_.load(std::memory_order_relaxed);
+  }
+  int getOutputOverflowCount() const {
+    return outputOverflows_.load(std::memory_order_relaxed);
+  }
+  void resetOutputStats() {
+    outputMaxDepth_.store(0, std::memory_order_relaxed);
+    outputOverflows_.store(0, std::memory_order_relaxed);
+  }
+
+  // step of the sequencer play head at the end of the last block, safe to
+  // read from any thread (for the GUI)
+  int getSequencerStepIndex() const {
+    return sequencerStepIndex_.load(std::memory_order_relaxed);
+  }
+
+  void prepareToPlay(double sampleRate, int maximumBlockSize) {
+    juce::ignoreUnused(maximumBlockSize);
+    sampleRate_ = sampleRate;
+    outputBuffer_.ensureSize(OUTPUT_BUFFER_SIZE);
+    arpeggiator_.restartRandom();
+  }
+
+  // renders one audio block: the incoming MIDI messages in midiMessages are
+  // consumed at their sample positions and replaced by the generated output
+  // with every note placed at the exact sample of its position
+  void processBlock(juce::MidiBuffer& midiMessages, int numSamples) {
+    CommandMessage command;
+    while (commands_.pop(command)) {
+      handleCommand(command);
+    }
+    auto changed = latestValueMask_.exchange(0, std::memory_order_acquire);
+    for (std::size_t slot = 0; slot < NUM_LATEST_VALUES; ++slot) {
+      if (changed & (1u << slot)) {
+        handleCommand(
+            {static_cast<Command>(static_cast<std::size_t>(Command::Bpm) +
+                                  slot),
+             latestValues_[slot].load(std::memory_order_relaxed)});
       }
+    }
 
-      arpeggiator_.tick();  // warning: do not tick arp before seq
+    for (const auto metadata : midiMessages) {
+      advance(metadata.samplePosition - blockOffset_);
 
-      // substraction is fine, but modulo feels safer
-      timeSinceStart_ = std::fmod(timeSinceStart_, one_tick_time_with_swing);
+      auto message = metadata.getMessage();
+      message.setTimeStamp(now());
+      if (message.isNoteOn()) {
+        handleNoteOn(message);
+      } else if (message.isNoteOff()) {
+        handleNoteOff(message);
+      }
+    }
+    advance(numSamples - blockOffset_);
+
+    // events placed after the end of the block (a fraction of a tick after
+    // a tick near the end) wait for the next one
+    auto block_end = blockStartTime_ + numSamples;
+    OutputEvent event;
+    for (int pending = outputQueue_.size(); pending > 0; --pending) {
+      outputQueue_.pop(event);
+      if (event.time < block_end) {
+        outputBuffer_.addEvent(event.data, event.size,
+                               static_cast<int>(event.time - blockStartTime_));
+      } else {
+        outputQueue_.push(event);
+      }
     }
+    midiMessages.swapWith(outputBuffer_);
+    outputBuffer_.clear();
+    // the buffer just taken from the host may be smaller, grow it here once
+    // rather than in addEvent (no-op when already large enough)
+    outputBuffer_.ensureSize(OUTPUT_BUFFER_SIZE);
+    blockStartTime_ += numSamples;
+    blockOffset_ = 0;
+
+    publishRecordedSteps();
+    sequencerStepIndex_.store(sequencer_.getCurrentStepIndex(),
+                              std::memory_order_relaxed);
   }
 
 private:
+  struct CommandMessage {
+    Command command;
+    double value;
+  };
+
+  CircularBuffer<CommandMessage, COMMAND_QUEUE_SIZE> commands_;
+
+  // one slot per continuous command, Bpm onwards
+  static constexpr std::size_t NUM_LATEST_VALUES =
+      static_cast<std::size_t>(Command::NumVoices) -
+      static_cast<std::size_t>(Command::Bpm) + 1;
+  std::array<std::atomic<double>, NUM_LATEST_VALUES> latestValues_{};
+  std::atomic<std::uint32_t> latestValueMask_{0};
+
+  void handleCommand(const CommandMessage& message) {
+    bool enabled = message.value > 0.0;
+    int index = static_cast<int>(message.value);
+
+    switch (message.command) {
+      case Command::SequencerPlay:
+        setSequencerPlay(enabled);
+        break;
+      case Command::SequencerRest:
+        setSequencerRest(enabled);
+        break;
+      case Command::SequencerArmed:
+        setSequencerArmed(enabled);
+        break;
+      case Command::QuantizeRec:
+        setQuantizeRec(enabled);
+        break;
+      case Command::KeyTrigger:
+        setKeyTrigger(enabled);
+        break;
+      case Command::KeytriggerMode:
+        setKeytriggerMode(static_cast<KeytriggerMode>(index));
+        break;
+      case Command::Hold:
+        setHold(enabled);
+        break;
+      case Command::Arp:
+        setArp(enabled);
+        break;
+      case Command::ArpVelocityMode:
+        arpeggiator_.setVelocityMode(
+            static_cast<Arpeggiator::VelocityMode>(index));
+        break;
+      case Command::Bpm:
+        setBpm(message.value);
+        break;
+      case Command::Swing:
+        setSwing(message.value);
+        break;
+      case Command::NumVoices:
+        voiceLimiter_.setNumVoices(static_cast<size_t>(index));
+        break;
+    }
+  }
+
+  // current time in samples
+  double now() const {
+    return static_cast<double>(blockStartTime_ + blockOffset_);
+  }
+
+  // move the play head forward, firing every tick that falls inside
+  // ticks on which neither part has anything to do are skipped in one go
+  void advance(int numSamples) {
+    int end = blockOffset_ + numSamples;
+
+    while (true) {
+      // jump to the last idle tick inside the block, so that the parts are up
+      // to date when the next block starts with new notes or a transport
+      // change. idle ticks all last as long (none is on the step grid, where
+      // swing changes)
+      int idle_ticks = getIdleTicksBefore(end, getIdleTicks());
+      if (idle_ticks > 0) {
+        int last_offset =
+            blockOffset_ + std::max(0, getSamplesUntilTick(idle_ticks - 1));
+        int elapsed = last_offset - blockOffset_;
+        if (isFollowingHost()) {
+          hostTicks_ += elapsed / getOneTickSamples();
+          nextSongTick_ += idle_ticks;
+        } else {
+          samplesSinceTick_ =
+              std::fmod(samplesSinceTick_ + elapsed,
+                        getOneTickTimeWithSwing() * sampleRate_);
+        }
+        blockOffset_ = last_offset;
+        skipTicks(idle_ticks);
+      }
+
+      int tick_offset = blockOffset_ + std::max(0, getSamplesUntilNextTick());
+      if (tick_offset >= end) {
+        break;
+      }
+
+      int elapsed = tick_offset - blockOffset_;
+      if (isFollowingHost()) {
+        hostTicks_ += elapsed / getOneTickSamples();
+        ++nextSongTick_;
+      } else {
+        // substraction is fine, but modulo feels safer
+        samplesSinceTick_ =
+            std::fmod(samplesSinceTick_ + elapsed,
+                      getOneTickTimeWithSwing() * sampleRate_);
+      }
+      blockOffset_ = tick_offset;
+      tick();
+    }
+
+    if (isFollowingHost()) {
+      hostTicks_ += (end - blockOffset_) / getOneTickSamples();
+    } else {
+      samplesSinceTick_ += end - blockOffset_;
+    }
+    blockOffset_ = end;
+  }
+
+  int getSamplesUntilNextTick() const { return getSamplesUntilTick(0); }
+
+  // ticksAhead = 0 is the next tick, all of them in the same step
+  int getSamplesUntilTick(int ticksAhead) const {
+    if (isFollowingHost()) {
+      return static_cast<int>(
+          std::ceil((getStraightTick(nextSongTick_ + ticksAhead) - hostTicks_) *
+                    getOneTickSamples()));
+    } else {
+      return static_cast<int>(
+          std::ceil((ticksAhead + 1) * getOneTickTimeWithSwing() * sampleRate_ -
+                    samplesSinceTick_));
+    }
+  }
+
+  // ticks before the next one on which a part has something to do
+  int getIdleTicks() const {
+    int ticks = arpeggiator_.getTicksToNextEvent();
+    if (sequencerIsTicking_) {
+      ticks = std::min(ticks, sequencer_.getTicksToNextEvent());
+    }
+    return ticks;
+  }
+
+  // how many of the next ticks fall before offset, at most maxTicks
+  // (binary search, so that long idle stretches cost nothing per tick)
+  int getIdleTicksBefore(int offset, int maxTicks) const {
+    int low = 0;
+    int high = maxTicks;
+    while (low < high) {
+      int middle = (low + high + 1) / 2;
+      if (blockOffset_ + getSamplesUntilTick(middle - 1) < offset) {
+        low = middle;
+      } else {
+        high = middle - 1;
+      }
+    }
+    return low;
+  }
+
+  void skipTicks(int ticks) {
+    if (sequencerIsTicking_) {
+      sequencer_.skip(ticks);
+    }
+    arpeggiator_.skip(ticks);
+  }
+
+  bool isFollowingHost() const {
+    return clockSource_ == ClockSource::Host && hostIsPlaying_;
+  }
+
+  // MARK: host sync
+  void syncPartsToSong(bool relocated) {
+    if (sequencerIsTicking_ && !sequencerKeyTrigger_) {
+      if (relocated || sequencer_.getTick() !=
+                           sequencer_.getTickAtSongPosition(nextSongTick_)) {
+        sequencer_.locate(nextSongTick_);
+
+        // real-time recording measures note offsets from a step boundary
+        int ticks_per_step = sequencer_.getTicksPerStep();
+        int ticks_into_step =
+            (sequencer_.getTick() % ticks_per_step + ticks_per_step) %
+            ticks_per_step;
+        seqStartTime_ = now() + getSamplesUntilNextTick() -
+                        ticks_into_step * getOneTickSamples();
+      }
+    }
+
+    if (!arpeggiator_.isMuted()) {
+      auto ticks_per_step = arpeggiator_.getTicksPerStep();
+      if (relocated ||
+          (arpeggiator_.getTick() - nextSongTick_) % ticks_per_step != 0) {
+        alignArpeggiatorToSong();
+      }
+    }
+  }
+
+  // restart the arp so that its first step lands on the next step of the song
+  void alignArpeggiatorToSong() {
+    auto ticks_per_step = arpeggiator_.getTicksPerStep();
+    auto ticks_to_grid =
+        ((-nextSongTick_) % ticks_per_step + ticks_per_step) % ticks_per_step;
+    arpeggiator_.reset(-static_cast<float>(ticks_to_grid) /
+                       static_cast<float>(ticks_per_step));
+  }
+
+  // swing on the song timeline: strong steps are stretched by (1 + swing) and
+  // weak steps squeezed by (1 - swing), so every pair of steps stays in place
+  double getSwungTick(double straightTick) const {
+    double pair_length = 2.0 * getSwingTicksPerStep();
+    double pair_start = std::floor(straightTick / pair_length) * pair_length;
+    double position = straightTick - pair_start;
+    double strong_length = getSwingTicksPerStep() * (1.0 + swing_);
+
+    if (position < strong_length) {
+      return pair_start + position / (1.0 + swing_);
+    } else {
+      return pair_start + getSwingTicksPerStep() +
+             (position - strong_length) / (1.0 - swing_);
+    }
+  }
+
+  double getStraightTick(juce::int64 swungTick) const {
+    double pair_length = 2.0 * getSwingTicksPerStep();
+    double pair_start =
+        std::floor(static_cast<double>(swungTick) / pair_length) * pair_length;
+    double position = static_cast<double>(swungTick) - pair_start;
+
+    if (position < getSwingTicksPerStep()) {
+      return pair_start + position * (1.0 + swing_);
+    } else {
+      return pair_start + getSwingTicksPerStep() * (1.0 + swing_) +
+             (position - getSwingTicksPerStep()) * (1.0 - swing_);
+    }
+  }
+
+  double getSwingTicksPerStep() const {
+    if (sequencerIsTicking_) {
+      return sequencer_.getTicksPerStep();
+    } else {
+      return arpeggiator_.getTicksPerStep();
+    }
+  }
+
+  void tick() {
+    // worry: if seq is stopped when arp is running, they might be out of sync
+    if (sequencerIsTicking_) {
+      // MARK: rest
+      // if (sequencerRest_) {
+      //   if (sequencerArmed_) {
+      //     sequencer_.resetStepAtIndex(current_index);
+      //   }
+      // }
+
+      sequencer_.tick();  // overdub happens inside
+      recordedSteps_ |= sequencer_.takeOverdubbedSteps();
+    }
+
+    arpeggiator_.tick();  // warning: do not tick arp before seq
+  }
+
   double getOneTickTime() const { return 15.0 / bpm_ / TICKS_PER_16TH; }
 
+  double getOneTickSamples() const { return getOneTickTime() * sampleRate_; }
+
   double getOneTickTimeWithSwing() const {
     if (isOnStrongBeat()) {
       return getOneTickTime() * (1 + swing_);
@@ -361,28 +800,27 @@ private:
     }
   }
 
-  Note calculateNoteFromNoteOnAndOff(juce::MidiMessage noteOn,
-                                     juce::MidiMessage noteOff) {
-#ifdef JUCE_DEBUG
-    jassert(noteOn.getNoteNumber() == noteOff.getNoteNumber());
-    // jassert(noteOn.getChannel() == noteOff.getChannel());
-#endif
-    int note_number = noteOn.getNoteNumber();
-    int velocity = noteOn.getVelocity();
-    // int channel = noteOn.getChannel();
+  Note calculateNoteFromNoteOnAndOff(int noteNumber,
+                                     KeyPress noteOn,
+                                     double noteOffTime) {
+    int note_number = noteNumber;
+    int velocity = noteOn.velocity;
+    // int channel = noteOn.channel;
+    double note_on_time =
+        noteOffTime - KeyboardState::getTimeSince(noteOn, noteOffTime);
 
-    double one_step_time = sequencer_.getTicksPerStep() * getOneTickTime();
+    double one_step_time =
+        sequencer_.getTicksPerStep() * getOneTickTime() * sampleRate_;
 
     double offset = 0.0;
     if (!sequencerRecQuantized_) {
       double steps_since_start =
-          (noteOn.getTimeStamp() - seqStartTime_) / one_step_time;
+          (note_on_time - seqStartTime_) / one_step_time;
       offset = steps_since_start -
                std::round(steps_since_start);  // wrap in [-0.5, 0.5)
     }
 
-    auto length =
-        (noteOff.getTimeStamp() - noteOn.getTimeStamp()) / one_step_time;
+    auto length = (noteOffTime - note_on_time) / one_step_time;
     length = std::min(
         length,
         static_cast<double>(sequencer_.getLength()));  // clip to track length
@@ -397,9 +835,13 @@ private:
   // or arp already started
   void startArpeggiator() {
     if (arpeggiator_.isMuted()) {
-      arpStartTime_ = GetSystemTime();
-      // timeSinceStart_ = 0.0;
+      arpStartTime_ = now();
+      // samplesSinceTick_ = 0.0;
       arpeggiator_.start();
+
+      if (isFollowingHost()) {
+        alignArpeggiatorToSong();
+      }
     }
   }
 
@@ -423,20 +865,15 @@ private:
         }
         sendMidiMessageToArp(note_on);
         // DBG("pass thru sequencer note on: " << note_on.getNoteNumber());
-      } else {
-        DBG("note on not triggered: " << note_on.getNoteNumber());
       }
+      // otherwise the note on is not triggered
     } else if (message.isNoteOff()) {
       auto& note_off = message;
       if (voiceLimiter_.noteOff(note_off.getNoteNumber(), prority)) {
         sendMidiMessageToArp(note_off);
-      } else {
-        DBG("sequencer note off not triggered (stolen): "
-            << note_off.getNoteNumber());
       }
+      // otherwise the note was stolen and already turned off
     }
-
-    DBG("Number Of active notes: " << voiceLimiter_.getNumActiveVoices());
   }
 
   // MARK: arp logic
@@ -459,35 +896,84 @@ private:
     }
   }
 
+  // part messages are stamped in ticks, the fraction of a tick is how far
+  // after the current one they are due
+  double getPartMessageTime(const juce::MidiMessage& message) const {
+    double ticks = message.getTimeStamp();
+    return now() + (ticks - std::floor(ticks)) * getOneTickTimeWithSwing() *
+                       sampleRate_;
+  }
+
   void sendMidiMessageToOuput(juce::MidiMessage message) {
     message.setChannel(1);  // force channel 1
-    midiCollector_.addMessageToQueue(message);
+
+    OutputEvent event;
+    event.time = std::max(blockStartTime_ + blockOffset_,
+                          static_cast<juce::int64>(
+                              std::round(message.getTimeStamp())));
+
+    // never let a message overtake an earlier one of the same note (a note
+    // off sent now after a note on due a fraction of a tick later)
+    if (message.isNoteOnOrOff()) {
+      auto& last_time = lastNoteTimes_[message.getNoteNumber()];
+      event.time = std::max(event.time, last_time);
+      last_time = event.time;
+    }
+
+    event.size = static_cast<std::uint8_t>(
+        std::min(message.getRawDataSize(), OutputEvent::MAX_SIZE));
+    std::copy_n(message.getRawData(), event.size, event.data);
+
+    if (!outputQueue_.push(event)) {
+      outputOverflows_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    int depth = outputQueue_.size();
+    if (depth > outputMaxDepth_.load(std::memory_order_relaxed)) {
+      outputMaxDepth_.store(depth, std::memory_order_relaxed);
+    }
   }
 
   void sendAllNotesOffToOutput() {
-    double now = GetSystemTime();
     auto active_notes = voiceLimiter_.getActiveNotes();
     for (int note : active_notes) {
       auto note_off = juce::MidiMessage::noteOff(1, note);
-      note_off.setTimeStamp(now);
+      note_off.setTimeStamp(now());
       sendMidiMessageToOuput(note_off);
     }
   }
 
   // from note limiter
   void allNotesOff() {
-    double now = GetSystemTime();
     auto active_notes = keyboard_.getNoteStack();
     // auto active_notes = voiceLimiter_.getActiveNotes();
 
     for (int note : active_notes) {
       auto note_off = juce::MidiMessage::noteOff(1, note);
-      note_off.setTimeStamp(now);
+      note_off.setTimeStamp(now());
       handleNoteOff(note_off, false);
     }
     // keyboard_.reset();
   }
 
+  void applyPendingPattern() {
+    if (hasPendingPattern_) {
+      sequencer_.setPattern(pendingPattern_);
+      hasPendingPattern_ = false;
+    }
+  }
+
+  void publishRecordedSteps() {
+    for (auto steps = recordedSteps_; steps != 0; steps &= steps - 1) {
+      int index = std::countr_zero(steps);
+      if (!stepChanges_.push(
+              {recordingPass_, index, sequencer_.getStepAtIndex(index)})) {
+        return;  // queue full, the rest is sent after the next block
+      }
+      recordedSteps_ &= ~(std::uint64_t{1} << index);
+    }
+  }
+
   // MARK: private vars
   double bpm_;
   double swing_;  // -0.75..0.75, move weak beats earlier/later
@@ -506,8 +992,17 @@ private:
   bool arpOn_;
   double arpStartTime_;
 
+  // host sync
+  ClockSource clockSource_;
+  bool hostIsPlaying_;
+  double hostTicks_;           // song position, advanced within the block
+  juce::int64 nextSongTick_;  // swung song tick the next tick() belongs to
+
   // for both arp and seq
-  double timeSinceStart_;
+  double sampleRate_;
+  juce::int64 blockStartTime_;  // in samples
+  int blockOffset_;             // sample position inside the current block
+  double samplesSinceTick_;
   bool hold_;
 
   Arpeggiator arpeggiator_;
@@ -517,8 +1012,36 @@ private:
   // real-time recording
   KeyboardState keyboard_;
   int noteToStepIndex_[128];
-
-  juce::MidiMessageCollector& midiCollector_;
+  std::uint32_t recordingPass_;
+  std::uint64_t recordedSteps_;  // bit i set if step i is not published yet
+  CircularBuffer<StepChange, STEP_CHANGE_QUEUE_SIZE> stepChanges_;
+
+  Pattern pendingPattern_{};
+  bool hasPendingPattern_ = false;
+
+  // output of the block being rendered, queued as plain events in time order
+  // and copied into a pre-sized buffer that is swapped into the host's buffer
+  struct OutputEvent {
+    static constexpr int MAX_SIZE = 3;  // channel voice messages only
+
+    juce::int64 time;  // in samples
+    std::uint8_t data[MAX_SIZE];
+    std::uint8_t size;
+  };
+
+  CircularBuffer<OutputEvent, OUTPUT_QUEUE_SIZE> outputQueue_;
+  juce::int64 lastNoteTimes_[128]{};  // of the latest queued event per note
+  std::atomic<int> outputMaxDepth_;
+  std::atomic<int> outputOverflows_;
+
+  std::atomic<int> sequencerStepIndex_;
+
+  // bytes for a full output queue: MidiBuffer stores a 4-byte sample
+  // position and a 2-byte size in front of every message
+  static constexpr size_t OUTPUT_BUFFER_SIZE =
+      static_cast<size_t>(OUTPUT_QUEUE_SIZE) *
+      (sizeof(std::int32_t) + sizeof(std::uint16_t) + OutputEvent::MAX_SIZE);
+  juce::MidiBuffer outputBuffer_;
 
   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ArpSeq)
 };
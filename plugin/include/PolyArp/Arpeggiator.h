@@ -1,6 +1,7 @@
 #pragma once
 #include "PolyArp/Part.h"
 #include "PolyArp/KeyboardState.h"
+#include "PolyArp/Rhythm.h"
 
 namespace Sequencer {
 
@@ -101,6 +102,10 @@ public:
   // step index will wrap to 0 after reaching ARP_MAX_LENGTH
   static constexpr int ARP_MAX_LENGTH = 65536;
 
+  static constexpr int ARP_MAX_OCTAVE = 4;
+
+  static constexpr std::uint64_t DEFAULT_RANDOM_SEED = 0x9e3779b97f4a7c15ull;
+
   Arpeggiator(int channel,
               int length = ARP_MAX_LENGTH,
               Resolution resolution = _8th,
@@ -114,23 +119,51 @@ public:
         velocityMode_(VelocityMode::Manual),
         fixedVelocity_(DEFAULT_VELOCITY),
         euclidLegato_(false),
+        rhythmPatternEnabled_(false),
+        randomSeed_(DEFAULT_RANDOM_SEED),
+        numShuffledNotes_(0),
+        arpCycleLength_(0),
+        arpCycleLoopStart_(0),
+        arpCyclePosition_(0),
+        arpCycleValid_(false),
         patternLength_(16),
         currentOctave_(0),
         interval_(0),
         lastNote_(DUMMY_NOTE),
         rising_(true) {
+    restartRandom();
     stop();
-    shuffledNoteList_.reserve(128);
     setFixedVelocity(100);
   }
 
-  void setType(ArpType type) { type_ = type; }
+  void setType(ArpType type) {
+    if (type_ != type) {
+      type_ = type;
+      arpCycleValid_ = false;
+    }
+  }
 
   void setEuclidPattern(EuclidPattern pattern);
 
+  // any euclidean rhythm up to RHYTHM_MAX_LENGTH steps, see Rhythm::Euclidean
+  void setEuclid(int fill, int length, int rotation = 0) {
+    euclid_ = Rhythm::Euclidean(fill, length, rotation);
+  }
+
+  // 0 is off, 1..YARNS_NUM_PATTERNS pick a Yarns pattern which then replaces
+  // the euclid pattern (euclid legato still applies)
+  void setRhythmPattern(int pattern) {
+    rhythmPatternEnabled_ = pattern > 0;
+    if (rhythmPatternEnabled_) {
+      rhythmPattern_ = Rhythm::Yarns(pattern - 1);
+    }
+  }
+
   void setOctave(int octave) {
+    octave = std::clamp(octave, 1, ARP_MAX_OCTAVE);
     if (octave_ != octave) {
       octave_ = octave;
+      arpCycleValid_ = false;
       shuffleNotesWithOctave();
       // generateRandomPatternWithOctave();
     }
@@ -143,12 +176,14 @@ public:
 
   void handleNoteOn(juce::MidiMessage noteOn) {
     keyboard_.handleNoteOn(noteOn);
+    arpCycleValid_ = false;
     shuffleNotesWithOctave();
     generateRandomPatternWithOctave();
   }
 
   void handleNoteOff(juce::MidiMessage noteOff) {
     keyboard_.handleNoteOff(noteOff);
+    arpCycleValid_ = false;
     // automatically stop when all notes are off
     if (keyboard_.getNumNotesPressed() == 0) {
       stop();
@@ -163,6 +198,7 @@ public:
   // note: calling this function has no effect if arp is not running
   void stop(bool immediateNoteOff = false) {
     keyboard_.reset();
+    arpCycleValid_ = false;
 
     // if (!isMuted()) {
     setMuted(true);
@@ -185,6 +221,23 @@ public:
 
   void setTransposeInterval(int semitones) { interval_ = semitones; }
 
+  // the random arp types replay identically from the same seed
+  // restarts the random streams only if the seed changed
+  void setRandomSeed(std::uint64_t seed) {
+    if (randomSeed_ != seed) {
+      randomSeed_ = seed;
+      restartRandom();
+    }
+  }
+
+  std::uint64_t getRandomSeed() const { return randomSeed_; }
+
+  // rewind the random streams to the start of the seed
+  void restartRandom() {
+    noteRandom_.setSeed(randomSeed_, 0);
+    octaveRandom_.setSeed(randomSeed_, 1);
+  }
+
   void setPatternLength(int length) {
     length = std::clamp(length, 1, 16);
 
@@ -222,13 +275,46 @@ private:
   }
 
   // euclidean rhythm generator
-  int euclidFill_;  // pulses
-  int euclidLength_;
-  int euclidRotate_;
+  Rhythm euclid_;
   bool euclidLegato_;
 
+  // rhythm pattern bank
+  Rhythm rhythmPattern_;
+  bool rhythmPatternEnabled_;
+
+  const Rhythm& getRhythm() const {
+    return rhythmPatternEnabled_ ? rhythmPattern_ : euclid_;
+  }
+
+  // separate streams so that the octave choice does not shift the notes
+  std::uint64_t randomSeed_;
+  RandomStream noteRandom_;
+  RandomStream octaveRandom_;
+
   // implementation
-  std::vector<int> shuffledNoteList_;  // optimize: minimize reallocation
+  // held notes in every octave, deduplicated, shuffled in place
+  int shuffledNotes_[128 + 12 * (ARP_MAX_OCTAVE - 1)];
+  int numShuffledNotes_;
+
+  // the classic types and Manual walk through (note, octave, direction)
+  // states that only depend on the held notes, the octave and the type
+  // the walk is compiled into a flat array once they change, a step is then
+  // a lookup. it may start with a tail that is not repeated (e.g. the first
+  // rising note of Rise Fall), then loops from arpCycleLoopStart_
+  struct ArpState {
+    std::int16_t note;
+    std::int8_t octave;
+    bool rising;
+  };
+
+  static constexpr int ARP_MAX_CYCLE_LENGTH = 128 * ARP_MAX_OCTAVE * 2;
+
+  ArpState arpCycle_[ARP_MAX_CYCLE_LENGTH];
+  int arpCycleLength_;
+  int arpCycleLoopStart_;
+  int arpCyclePosition_;
+  bool arpCycleValid_;
+
   std::array<int, 16> notePattern_;
   std::array<int, 16> octavePattern_;
   int patternLength_;
@@ -239,6 +325,9 @@ private:
 
   void shuffleNotesWithOctave();
 
+  // shuffle only the first count notes of shuffledNotes_
+  void drawShuffledNotes(int count);
+
   void generateRandomPatternWithOctave();
 
   // void removeNoteFromPattern(int note) {
@@ -249,7 +338,14 @@ private:
   //   }
   // }
 
-  int getAdjacentArpNote(bool repeat_boundary);
+  // the state played on step 0
+  ArpState getFirstArpState() const;
+
+  // the state played after state with the current held notes
+  ArpState getNextArpState(int note, int octave, bool rising) const;
+
+  // walk from first until a state repeats
+  void compileArpCycle(ArpState first);
 
   int getStepRenderTick(int index) const override final {
     return index * getTicksPerStep();  // render on beat
@@ -0,0 +1,66 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// wait-free single-producer single-consumer ring buffer
+// one thread may push, one (other) thread may pop, neither ever blocks
+// the producer owns head_, the consumer owns tail_, each only reads the other
+// all storage lives inside the object: nothing is allocated after construction
+
+namespace Sequencer {
+
+template <typename T, int CAPACITY>
+class CircularBuffer {
+  static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0,
+                "capacity must be a power of two");
+  static_assert(std::is_trivially_copyable_v<T>);
+
+public:
+  CircularBuffer() : head_(0), tail_(0) {}
+
+  // producer side
+  // return false (and drop the item) if the buffer is full
+  bool push(const T& item) {
+    auto head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) == MASK + 1) {
+      return false;
+    }
+    items_[head & MASK] = item;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // consumer side
+  bool pop(T& item) {
+    auto tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = items_[tail & MASK];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // a snapshot, exact only when called from the consumer or producer side
+  // while the other side is idle
+  int size() const {
+    return static_cast<int>(head_.load(std::memory_order_acquire) -
+                            tail_.load(std::memory_order_acquire));
+  }
+
+  bool empty() const { return size() == 0; }
+
+  static constexpr int capacity() { return CAPACITY; }
+
+private:
+  static constexpr std::uint32_t MASK = CAPACITY - 1;
+
+  // indices grow freely and wrap around at 2^32, a multiple of CAPACITY
+  alignas(64) std::atomic<std::uint32_t> head_;  // next slot to write
+  alignas(64) std::atomic<std::uint32_t> tail_;  // next slot to read
+  alignas(64) T items_[static_cast<std::size_t>(CAPACITY)];
+};
+
+}  // namespace Sequencer
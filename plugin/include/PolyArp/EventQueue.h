@@ -0,0 +1,188 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+// fixed capacity MIDI event queue ordered by tick
+// events with the same tick come out in insertion order (note off before the
+// note on that was rendered right after it)
+// all storage lives inside the object: nothing is allocated after construction
+// every queued event has a handle that stays valid until it is popped or
+// removed, so that a known event can be found without searching the queue
+
+namespace Sequencer {
+
+// 3-byte channel voice message with a timestamp in ticks
+struct MidiEvent {
+  std::int64_t tick;
+  std::uint8_t status;  // message type | (channel - 1)
+  std::uint8_t data1;   // note number
+  std::uint8_t data2;   // velocity
+  float subTick = 0.f;  // 0..1 of a tick after tick, fits in the padding
+
+  static MidiEvent noteOn(std::int64_t tick,
+                          int channel,
+                          int note,
+                          int velocity) {
+    return {tick, static_cast<std::uint8_t>(0x90 | ((channel - 1) & 0x0f)),
+            static_cast<std::uint8_t>(note),
+            static_cast<std::uint8_t>(velocity)};
+  }
+
+  static MidiEvent noteOff(std::int64_t tick,
+                           int channel,
+                           int note,
+                           int velocity) {
+    return {tick, static_cast<std::uint8_t>(0x80 | ((channel - 1) & 0x0f)),
+            static_cast<std::uint8_t>(note),
+            static_cast<std::uint8_t>(velocity)};
+  }
+
+  bool isNoteOn() const { return (status & 0xf0) == 0x90 && data2 > 0; }
+
+  bool isNoteOff() const {
+    return (status & 0xf0) == 0x80 || ((status & 0xf0) == 0x90 && data2 == 0);
+  }
+
+  int getNoteNumber() const { return data1; }
+};
+
+using EventHandle = int;
+
+// binary min-heap: push, pop and remove are O(log n)
+template <int CAPACITY>
+class EventQueue {
+  static_assert(CAPACITY > 0);
+
+public:
+  EventQueue() : size_(0), nextOrder_(0) {
+    for (int i = 0; i < CAPACITY; ++i) {
+      freeHandles_[i] = CAPACITY - 1 - i;
+    }
+  }
+
+  int size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  bool full() const { return size_ == CAPACITY; }
+
+  void clear() {
+    while (size_ > 0) {
+      freeHandles_[CAPACITY - size_] = heap_[size_ - 1].handle;
+      --size_;
+    }
+  }
+
+  // return false (and drop the event) if the queue is full
+  bool push(MidiEvent event, EventHandle* handle = nullptr) {
+    if (full()) {
+      return false;
+    }
+    EventHandle new_handle = freeHandles_[CAPACITY - 1 - size_];
+    heap_[size_] = {event, nextOrder_++, new_handle};
+    positions_[new_handle] = size_;
+    siftUp(size_++);
+    if (handle) {
+      *handle = new_handle;
+    }
+    return true;
+  }
+
+  // caller is responsible to check !empty()
+  const MidiEvent& top() const { return heap_[0].event; }
+
+  // pop the earliest event if it is due at or before tick
+  // handle (if given) receives the handle the event was queued with
+  bool popDue(std::int64_t tick,
+              MidiEvent& event,
+              EventHandle* handle = nullptr) {
+    if (empty() || heap_[0].event.tick > tick) {
+      return false;
+    }
+    event = heap_[0].event;
+    if (handle) {
+      *handle = heap_[0].handle;
+    }
+    removeAt(0);
+    return true;
+  }
+
+  // handle must belong to an event still in the queue
+  const MidiEvent& get(EventHandle handle) const {
+    return heap_[positions_[handle]].event;
+  }
+
+  void remove(EventHandle handle) { removeAt(positions_[handle]); }
+
+private:
+  struct Entry {
+    MidiEvent event;
+    std::uint64_t order;  // tie breaker for events on the same tick
+    EventHandle handle;
+  };
+
+  Entry heap_[static_cast<std::size_t>(CAPACITY)];
+  int size_;
+  std::uint64_t nextOrder_;
+  int positions_[static_cast<std::size_t>(CAPACITY)];  // by handle
+  // stack of unused handles, the first CAPACITY - size_ entries
+  EventHandle freeHandles_[static_cast<std::size_t>(CAPACITY)];
+
+  bool isBefore(int a, int b) const {
+    const auto& x = heap_[a];
+    const auto& y = heap_[b];
+    if (x.event.tick != y.event.tick) {
+      return x.event.tick < y.event.tick;
+    }
+    return x.order < y.order;
+  }
+
+  void swapEntries(int a, int b) {
+    std::swap(heap_[a], heap_[b]);
+    positions_[heap_[a].handle] = a;
+    positions_[heap_[b].handle] = b;
+  }
+
+  void siftUp(int i) {
+    while (i > 0) {
+      int parent = (i - 1) / 2;
+      if (!isBefore(i, parent)) {
+        break;
+      }
+      swapEntries(i, parent);
+      i = parent;
+    }
+  }
+
+  void siftDown(int i) {
+    while (true) {
+      int left = 2 * i + 1;
+      int right = left + 1;
+      int smallest = i;
+      if (left < size_ && isBefore(left, smallest)) {
+        smallest = left;
+      }
+      if (right < size_ && isBefore(right, smallest)) {
+        smallest = right;
+      }
+      if (smallest == i) {
+        break;
+      }
+      swapEntries(i, smallest);
+      i = smallest;
+    }
+  }
+
+  void removeAt(int i) {
+    --size_;
+    freeHandles_[CAPACITY - 1 - size_] = heap_[i].handle;
+    if (i == size_) {
+      return;
+    }
+    heap_[i] = heap_[size_];
+    positions_[heap_[i].handle] = i;
+    siftDown(i);
+    siftUp(i);
+  }
+};
+
+}  // namespace Sequencer
@@ -1,6 +1,9 @@
 #pragma once
 #include <juce_audio_processors/juce_audio_processors.h>  //juce::MidiMessage
+#include "PolyArp/NoteSet.h"
+#include "PolyArp/Random.h"
 #include <algorithm>
+#include <cstdint>
 #include <vector>
 // TODO: remove dependency on juce::MidiMessage
 
@@ -12,59 +15,78 @@ inline bool IsDummyNote(int note) {
   return note == -1;
 }
 
+// what is kept of a note on message, 8 bytes
+struct KeyPress {
+  std::uint32_t time;  // low 32 bits of the timestamp in samples
+  std::uint8_t velocity;
+  std::uint8_t channel;
+};
+
 class KeyboardState {
 public:
-  KeyboardState() : lastChannel_(1) {}
+  KeyboardState() : velocitySum_(0), lastChannel_(1) {
+    activeNoteStack_.reserve(128);
+  }
+
+  // samples from the key press to now, valid for notes held < 2^32 samples
+  static double getTimeSince(const KeyPress& press, double now) {
+    return static_cast<double>(toTime(now) - press.time);
+  }
 
   // let's pray that the user will not switch channel in the middle of a note
   int getLastChannel() const { return lastChannel_; }
 
-  void handleNoteOn(juce::MidiMessage noteOn) {
-    int note_number = static_cast<int>(noteOn.getNoteNumber());
-    toggleNoteOff(noteOn.getNoteNumber());
+  void handleNoteOn(const juce::MidiMessage& noteOn) {
+    int note_number = noteOn.getNoteNumber();
+    toggleNoteOff(note_number);
 
     if (activeNoteStack_.size() == 0) {  // first note
-      firstNote_ = static_cast<int>(noteOn.getNoteNumber());
+      firstNote_ = note_number;
     }
 
     activeNoteStack_.push_back(note_number);
-    noteOns_[note_number] = noteOn;
+    pressedNotes_.insert(note_number);
     lastChannel_ = noteOn.getChannel();
+
+    auto& press = keyPresses_[note_number];
+    press.time = toTime(noteOn.getTimeStamp());
+    press.velocity = noteOn.getVelocity();
+    press.channel = static_cast<std::uint8_t>(lastChannel_);
+    velocitySum_ += press.velocity;
   }
 
   // return true if successful
   bool toggleNoteOff(int note_number) {
-    auto it = std::find(activeNoteStack_.begin(), activeNoteStack_.end(),
-                        note_number);
-
-    if (it == activeNoteStack_.end()) {
+    if (!pressedNotes_.contains(note_number)) {
       return false;
-    } else {
-      activeNoteStack_.erase(it);
-      return true;
     }
+
+    pressedNotes_.erase(note_number);
+    velocitySum_ -= keyPresses_[note_number].velocity;
+    activeNoteStack_.erase(std::find(activeNoteStack_.begin(),
+                                     activeNoteStack_.end(), note_number));
+    return true;
   }
 
-  // returns the matched note on message
-  juce::MidiMessage handleNoteOff(juce::MidiMessage noteOff) {
+  // returns the matched key press (velocity 0 if there is none)
+  KeyPress handleNoteOff(const juce::MidiMessage& noteOff) {
     auto note_number = noteOff.getNoteNumber();
 
     if (toggleNoteOff(note_number)) {
-      return noteOns_[note_number];
-    } else {
-      DBG("note on and note off mismatch (KeyboardState)");
-      return juce::MidiMessage();
+      return keyPresses_[note_number];
     }
+    return {};  // note on and note off mismatch
   }
 
   void reset() {
     activeNoteStack_.clear();
-    // no need to clear noteOns_
+    pressedNotes_.clear();
+    velocitySum_ = 0;
+    // no need to clear keyPresses_
   }
 
   bool isKeyDown(int noteNumber) const {
-    return std::find(activeNoteStack_.begin(), activeNoteStack_.end(),
-                     noteNumber) != activeNoteStack_.end();
+    return pressedNotes_.contains(noteNumber);
   }
 
   int getNumNotesPressed() const {
@@ -80,20 +102,12 @@ public:
   // caller is responsible to check getNumNotesPressed() > 0
   int getLowestNote() const {
     jassert(!activeNoteStack_.empty());
-
-    auto result =
-        std::min_element(activeNoteStack_.begin(), activeNoteStack_.end());
-
-    return *result;
+    return pressedNotes_.lowest();
   }
 
   int getHighestNote() const {
     jassert(!activeNoteStack_.empty());
-
-    auto result =
-        std::max_element(activeNoteStack_.begin(), activeNoteStack_.end());
-
-    return *result;
+    return pressedNotes_.highest();
   }
 
   int getEarliestNote() const {
@@ -114,21 +128,24 @@ public:
   int getNextNote(int noteNumber) const {
     jassert(!activeNoteStack_.empty());
 
-    auto it =
-        std::find(activeNoteStack_.begin(), activeNoteStack_.end(), noteNumber);
-    if (it == activeNoteStack_.end()) {
-      // if note already removed, use midi time stamp to find the next note
-      auto note_on_time = noteOns_[noteNumber].getTimeStamp();
+    // the arp asks with DUMMY_NOTE before its first note and with notes
+    // shifted by octaves past 127, none of which has a key press
+    if (noteNumber < 0 || noteNumber > 127) {
+      return DUMMY_NOTE;
+    }
+
+    if (!pressedNotes_.contains(noteNumber)) {
+      // if note already removed, use key press time to find the next note
+      auto note_on_time = keyPresses_[noteNumber].time;
 
-      double best_time = std::numeric_limits<double>::max();
+      std::uint32_t best_delay = 0;
       int best_note_number = DUMMY_NOTE;
 
       for (int n : activeNoteStack_) {
-        auto active_note_on_time = noteOns_[n].getTimeStamp();
-        if (active_note_on_time > note_on_time) {
-          if (best_note_number == DUMMY_NOTE ||
-              best_time > active_note_on_time) {
-            best_time = active_note_on_time;
+        auto delay = keyPresses_[n].time - note_on_time;
+        if (static_cast<std::int32_t>(delay) > 0) {
+          if (best_note_number == DUMMY_NOTE || best_delay > delay) {
+            best_delay = delay;
             best_note_number = n;
           }
         }
@@ -137,6 +154,8 @@ public:
       return best_note_number;
     }
 
+    auto it =
+        std::find(activeNoteStack_.begin(), activeNoteStack_.end(), noteNumber);
     ++it;
     if (it == activeNoteStack_.end()) {
       return DUMMY_NOTE;
@@ -148,39 +167,19 @@ public:
 
   int getHigherNote(int noteNumber) const {
     jassert(!activeNoteStack_.empty());
-
-    int best_note_number = DUMMY_NOTE;
-    for (int n : activeNoteStack_) {
-      if (n > noteNumber) {
-        if (best_note_number == DUMMY_NOTE || n < best_note_number) {
-          best_note_number = n;
-        }
-      }
-    }
-
-    return best_note_number;
+    return pressedNotes_.higherThan(noteNumber);
   }
 
   int getLowerNote(int noteNumber) const {
     jassert(!activeNoteStack_.empty());
-
-    int best_note_number = DUMMY_NOTE;
-    for (int n : activeNoteStack_) {
-      if (n < noteNumber) {
-        if (best_note_number == DUMMY_NOTE || n > best_note_number) {
-          best_note_number = n;
-        }
-      }
-    }
-
-    return best_note_number;
+    return pressedNotes_.lowerThan(noteNumber);
   }
 
-  int getRandomNote() const {
+  int getRandomNote(RandomStream& random) const {
     jassert(!activeNoteStack_.empty());
 
-    size_t index = static_cast<size_t>(juce::Random::getSystemRandom().nextInt(
-        static_cast<int>(activeNoteStack_.size())));
+    size_t index = static_cast<size_t>(
+        random.nextInt(static_cast<int>(activeNoteStack_.size())));
     int note_number = activeNoteStack_[index];
 
     return note_number;
@@ -189,21 +188,14 @@ public:
   int getAverageVelocity() const {
     if (activeNoteStack_.size() == 0) {
       return DEFAULT_VELOCITY;
-    } else if (activeNoteStack_.size() == 1) {
-      return noteOns_[activeNoteStack_.front()].getVelocity();
     }
-
-    int velocity_sum = 0;
-    for (const auto& note_number : activeNoteStack_) {
-      velocity_sum += noteOns_[note_number].getVelocity();
-    }
-    return velocity_sum / static_cast<int>(activeNoteStack_.size());
+    return velocitySum_ / getNumNotesPressed();
   }
 
   // will return DEFAULT_VELOCITY if no note is being pressed
   int getLatestVelocity() const {
     if (getNumNotesPressed() > 0) {
-      return noteOns_[getLatestNote()].getVelocity();
+      return keyPresses_[getLatestNote()].velocity;
     } else {
       return DEFAULT_VELOCITY;
     }
@@ -212,16 +204,22 @@ public:
   // will return DEFAULT_VELOCITY for notes that are currently not pressed
   int getVelocityForNote(int noteNumber) const {
     if (isKeyDown(noteNumber)) {
-      return noteOns_[noteNumber].getVelocity();
+      return keyPresses_[noteNumber].velocity;
     } else {
       return DEFAULT_VELOCITY;
     }
   }
 
 private:
-  std::vector<int> activeNoteStack_;  // keep track of pressed notes
-  juce::MidiMessage noteOns_[128];    // hold actual note on messages
+  std::vector<int> activeNoteStack_;  // pressed notes in insertion order
+  NoteSet pressedNotes_;              // the same notes ordered by pitch
+  KeyPress keyPresses_[128];          // last note on of every key
+  int velocitySum_;                   // of the pressed notes
   int firstNote_;
   int lastChannel_;
+
+  static std::uint32_t toTime(double timeStamp) {
+    return static_cast<std::uint32_t>(static_cast<std::int64_t>(timeStamp));
+  }
 };
 }  // namespace Sequencer
@@ -1,4 +1,7 @@
 #pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 
 // TODO: make these constexpr
 // TODO: make sure the sequencer clamp incoming notes lower than 21 to 21
@@ -9,6 +12,10 @@
 #define DEFAULT_VELOCITY 100  // 1..127 since 0 is the same as NoteOff
 #define DEFAULT_LENGTH 0.75f  // gate
 
+// fixed point unit of packed note offset and length: 1/960 step, whatever
+// falls between two ticks is played at its sample (GetTickPosition)
+#define NOTE_TIME_UNITS_PER_STEP 960
+
 namespace Sequencer {
 
 static int WrapNoteIntoValidRange(int note_number) {
@@ -46,4 +53,20 @@ struct Note {
   }
 };
 
+// steps <-> fixed point, offset covers [-0.5, 0.5) and length up to 68 steps
+inline std::int16_t PackNoteOffset(float offset) {
+  int units = static_cast<int>(std::lround(offset * NOTE_TIME_UNITS_PER_STEP));
+  return static_cast<std::int16_t>(std::clamp(
+      units, -NOTE_TIME_UNITS_PER_STEP / 2, NOTE_TIME_UNITS_PER_STEP / 2 - 1));
+}
+
+inline std::uint16_t PackNoteLength(float length) {
+  int units = static_cast<int>(std::lround(length * NOTE_TIME_UNITS_PER_STEP));
+  return static_cast<std::uint16_t>(std::clamp(units, 0, 0xffff));
+}
+
+inline float UnpackNoteTime(int units) {
+  return static_cast<float>(units) / NOTE_TIME_UNITS_PER_STEP;
+}
+
 }  // namespace Sequencer
\ No newline at end of file
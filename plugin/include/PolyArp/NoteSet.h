@@ -0,0 +1,109 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+
+// set of MIDI note numbers (0-127) packed into two 64-bit words
+// every query is a couple of count leading/trailing zero instructions
+// any int is accepted: notes out of range are never in the set (the arp
+// shifts notes by octaves past 127)
+
+namespace Sequencer {
+
+class NoteSet {
+public:
+  static constexpr int NONE = -1;
+
+  NoteSet() : words_{0, 0} {}
+
+  void insert(int note) {
+    if (isValid(note)) {
+      words_[note >> 6] |= bit(note);
+    }
+  }
+
+  void erase(int note) {
+    if (isValid(note)) {
+      words_[note >> 6] &= ~bit(note);
+    }
+  }
+
+  void clear() { words_[0] = words_[1] = 0; }
+
+  NoteSet& operator|=(const NoteSet& other) {
+    words_[0] |= other.words_[0];
+    words_[1] |= other.words_[1];
+    return *this;
+  }
+
+  bool contains(int note) const {
+    return isValid(note) && (words_[note >> 6] & bit(note)) != 0;
+  }
+
+  bool empty() const { return (words_[0] | words_[1]) == 0; }
+
+  int size() const {
+    return std::popcount(words_[0]) + std::popcount(words_[1]);
+  }
+
+  // return NONE if the set is empty
+  int lowest() const { return higherThan(-1); }
+  int highest() const { return lowerThan(128); }
+
+  // closest note strictly above note, NONE if there is none
+  int higherThan(int note) const {
+    int from = std::max(note, -1) + 1;
+    if (from < 64) {
+      std::uint64_t low = words_[0] & maskFrom(from);
+      if (low != 0) {
+        return std::countr_zero(low);
+      }
+      from = 64;
+    }
+    if (from < 128) {
+      std::uint64_t high = words_[1] & maskFrom(from - 64);
+      if (high != 0) {
+        return 64 + std::countr_zero(high);
+      }
+    }
+    return NONE;
+  }
+
+  // closest note strictly below note, NONE if there is none
+  int lowerThan(int note) const {
+    int to = std::min(note, 128) - 1;
+    if (to >= 64) {
+      std::uint64_t high = words_[1] & maskTo(to - 64);
+      if (high != 0) {
+        return 127 - std::countl_zero(high);
+      }
+      to = 63;
+    }
+    if (to >= 0) {
+      std::uint64_t low = words_[0] & maskTo(to);
+      if (low != 0) {
+        return 63 - std::countl_zero(low);
+      }
+    }
+    return NONE;
+  }
+
+private:
+  std::uint64_t words_[2];
+
+  static bool isValid(int note) { return note >= 0 && note < 128; }
+
+  static std::uint64_t bit(int note) {
+    return std::uint64_t{1} << (note & 63);
+  }
+
+  // bits [from, 63]
+  static std::uint64_t maskFrom(int from) { return ~std::uint64_t{0} << from; }
+
+  // bits [0, to]
+  static std::uint64_t maskTo(int to) {
+    return ~std::uint64_t{0} >> (63 - to);
+  }
+};
+
+}  // namespace Sequencer
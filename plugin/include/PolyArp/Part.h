@@ -1,6 +1,8 @@
 #pragma once
 #include "PolyArp/Note.h"
-#include <juce_audio_basics/juce_audio_basics.h>  // juce::MidiMessageSequence
+#include "PolyArp/EventQueue.h"
+#include "PolyArp/NoteSet.h"
+#include <juce_audio_basics/juce_audio_basics.h>  // juce::MidiMessage
 
 /*
   sequencer/arpeggiator base class
@@ -20,8 +22,37 @@
 #define STEP_SEQ_MIN_LENGTH 4
 #define STEP_SEQ_DEFAULT_LENGTH 16
 
+// pending events per part, a Chord arp over 4 octaves needs about 3 per note
+#define EVENT_QUEUE_SIZE 512
+
+// internal resolution, 24 is 96 ppqn
+// can be raised at build time (240 is 960 ppqn), idle ticks are skipped so a
+// finer grid costs next to nothing
+#ifndef TICKS_PER_16TH
+#define TICKS_PER_16TH 24
+#endif
+#define TICKS_PER_QUARTER (TICKS_PER_16TH * 4)
+
+// every resolution down to 1/16T must have a whole number of ticks per half
+// step
+static_assert(TICKS_PER_16TH > 0 && TICKS_PER_16TH % 12 == 0,
+              "TICKS_PER_16TH must be a multiple of 12");
+
 namespace Sequencer {
 
+// a position in fractional steps as the tick at or before it, plus how far
+// into that tick it is, so that playback can place it between two ticks
+struct TickPosition {
+  int tick;
+  float fraction;  // 0..1
+};
+
+inline TickPosition GetTickPosition(float steps, int ticksPerStep) {
+  double ticks = static_cast<double>(steps) * ticksPerStep;
+  double tick = std::floor(ticks);
+  return {static_cast<int>(tick), static_cast<float>(ticks - tick)};
+}
+
 class Part {
 public:
   // mapped to ticks per step
@@ -43,7 +74,8 @@ public:
         resolution_(resolution),
         resolutionNew_(resolution),
         muted_(false),
-        tick_(0) {}
+        tick_(0),
+        loopOrigin_(0) {}
 
   virtual ~Part() = default;
 
@@ -71,15 +103,33 @@ public:
     }
   }
 
-  // callback to transfer MIDI messages (timestamp in ticks)
+  // callback to transfer MIDI messages (timestamp in ticks, the fraction is
+  // where the message falls between this tick and the next)
   std::function<void(juce::MidiMessage msg)> sendMidiMessage;
 
   // the manager of this class (and derived classes) is responsible to call this
   // function getTicksPerStep() times per step
   void tick();
 
+  // ticks before the next one on which tick() has something to do: render a
+  // step, send a queued event, reach the step grid, or reach the half step
+  // where length changes apply and the loop wraps. 0 if it is the next tick
+  int getTicksToNextEvent() const;
+
+  // same as calling tick() that many times, when none of them has anything
+  // to do (ticks <= getTicksToNextEvent())
+  void skip(int ticks);
+
   void reset(float start_index = 0.f);
 
+  // move to where the part would be at songTick if it had been looping since
+  // the song start, pending length/resolution changes are applied immediately
+  void locate(juce::int64 songTick);
+
+  // the tick that will be processed by the next call to tick()
+  int getTick() const { return tick_; }
+  int getTickAtSongPosition(juce::int64 songTick) const;
+
   // for GUI
   float getProgress() const {
     return static_cast<float>(tick_ + getTicksHalfStep()) /
@@ -96,8 +146,12 @@ public:
     }
   }
 
+  static constexpr int RESOLUTION_TICKS_TABLE[] = {
+      TICKS_PER_16TH / 2,     TICKS_PER_16TH,         TICKS_PER_16TH * 2,
+      TICKS_PER_16TH * 4,     TICKS_PER_16TH * 8 / 3, TICKS_PER_16TH * 4 / 3,
+      TICKS_PER_16TH * 2 / 3, TICKS_PER_16TH / 3};
+
   int getTicksPerStep() const {
-    static const int RESOLUTION_TICKS_TABLE[] = {12, 24, 48, 96, 64, 32, 16, 8};
     return RESOLUTION_TICKS_TABLE[static_cast<int>(resolution_)];
   }
 
@@ -111,8 +165,11 @@ public:
 protected:
   void renderNote(int index, Note note);
 
-  // timestamp in ticks (not seconds or samples)
-  void renderMidiMessage(juce::MidiMessage message);
+  // timestamp in ticks of the current loop (not seconds or samples)
+  // subTick (0..1) is where the event falls between its tick and the next
+  bool renderMidiEvent(MidiEvent event,
+                       float subTick = 0.f,
+                       EventHandle* handle = nullptr);
 
   int getTicksHalfStep() const { return getTicksPerStep() / 2; }
 
@@ -130,7 +187,19 @@ private:
   bool muted_;
 
   // function related variables
-  int tick_;
+  int tick_;  // position in the loop
+
+  // queued events are timed on a timeline that never wraps or jumps back,
+  // loopOrigin_ is where tick 0 of the current loop falls on it, so wrapping
+  // or relocating the loop only moves the origin and never touches the queue
+  juce::int64 loopOrigin_;
+  juce::int64 getAbsoluteTick() const { return loopOrigin_ + tick_; }
+
+  // continue from tick of the loop at the next call to tick()
+  void moveTo(int tick) {
+    loopOrigin_ = getAbsoluteTick() - tick;
+    tick_ = tick;
+  }
 
   // derived class must implement renderStep and getStepRenderTick
   virtual void renderStep(int index) = 0;
@@ -139,12 +208,24 @@ private:
   // helpers
   bool isOnGrid() const { return tick_ % getTicksPerStep() == 0; }
 
-  /*
-    invariant: MIDI messages are always sorted by timestamp
-    note: when porting to Spark/Prologue, change from juce::MidiMessageSequence
-    to a simpler data structure (something like FIFO queue)
-  */
-  juce::MidiMessageSequence midiQueue_, midiQueueNext_;
+  // move tick_ forward, applying length changes and wrapping the loop
+  void moveForward(int ticks);
+
+  void sendMidiEvent(MidiEvent event);
+
+  // future MIDI events in ticks, pre-allocated so that rendering never
+  // touches the heap
+  EventQueue<EVENT_QUEUE_SIZE> midiQueue_;
+
+  // the queued note off of every sounding note, so that a retrigger or a
+  // panic goes straight to it instead of searching the queue
+  NoteSet notesWithNoteOff_;
+  EventHandle noteOffs_[128];
+
+  void clearMidiQueue() {
+    midiQueue_.clear();
+    notesWithNoteOff_.clear();
+  }
 };
 
 }  // namespace Sequencer
\ No newline at end of file
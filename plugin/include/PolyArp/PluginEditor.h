@@ -7,7 +7,8 @@
 
 namespace audio_plugin {
 
-class AudioPluginAudioProcessorEditor : public juce::AudioProcessorEditor {
+class AudioPluginAudioProcessorEditor : public juce::AudioProcessorEditor,
+                                        private juce::Timer {
 public:
   explicit AudioPluginAudioProcessorEditor(AudioPluginAudioProcessor&);
   ~AudioPluginAudioProcessorEditor() override;
@@ -20,6 +21,13 @@ private:
   // access the processor object that created it.
   AudioPluginAudioProcessor& processorRef;
 
+  // commands that did not fit in the engine's queue are kept here, in order,
+  // and resent from the timer
+  using Command = Sequencer::ArpSeq::Command;
+  std::vector<std::pair<Command, double>> unsentCommands;
+  void sendCommand(Command command, double value);
+  void timerCallback() override;
+
   juce::MidiKeyboardComponent onScreenKeyboard;
 
   // arp
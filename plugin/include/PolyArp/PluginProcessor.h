@@ -2,10 +2,12 @@
 
 #include <juce_audio_processors/juce_audio_processors.h>
 #include "PolyArp/ArpSeq.h"
+#include "PolyArp/SnapshotBuffer.h"
+#include "PolyArp/StepParameters.h"
 
 namespace audio_plugin {
 class AudioPluginAudioProcessor : public juce::AudioProcessor,
-                                  private juce::HighResolutionTimer {
+                                  private juce::Timer {
 public:
   AudioPluginAudioProcessor();
   ~AudioPluginAudioProcessor() override;
@@ -37,8 +39,6 @@ public:
   void getStateInformation(juce::MemoryBlock& destData) override;
   void setStateInformation(const void* data, int sizeInBytes) override;
 
-  void hiResTimerCallback() override final;
-
   Sequencer::ArpSeq arpseq;
 
   juce::MidiKeyboardState keyboardState;  // MIDI visualizer
@@ -46,9 +46,18 @@ public:
   juce::AudioProcessorValueTreeState parameters;
   juce::UndoManager undoManager;
 
+  // O(1), note is ignored for StepField::Enabled
+  juce::RangedAudioParameter* getStepParameter(int step,
+                                               StepField field,
+                                               int note = 0) const {
+    return stepParams[GetStepParameterIndex(step, field, note)];
+  }
+
 private:
   juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
 
+  void applyParameters();
+
   // arp parameters
   std::atomic<float>* arpTypeParam;
   std::atomic<float>* arpOctaveParam;
@@ -56,18 +65,68 @@ private:
   std::atomic<float>* arpResolutionParam;
   std::atomic<float>* euclidPatternParam;
   std::atomic<float>* euclidLegatoParam;
+  std::atomic<float>* rhythmPatternParam;
   std::atomic<float>* arpTransposeParam;
 
+  // seed of the random arp types, saved with the plugin state
+  std::atomic<juce::int64> randomSeed;
+  void setRandomSeed(juce::int64 seed);
+
   // seq parameters
   std::atomic<float>* seqLengthParam;
-  std::atomic<float>* seqStepEnabledParam[STEP_SEQ_MAX_LENGTH];
-  std::atomic<float>* seqStepNoteParam[STEP_SEQ_MAX_LENGTH][POLYPHONY];
-  std::atomic<float>* seqStepVelocityParam[STEP_SEQ_MAX_LENGTH][POLYPHONY];
-  std::atomic<float>* seqStepOffsetParam[STEP_SEQ_MAX_LENGTH][POLYPHONY];
-  std::atomic<float>* seqStepLengthParam[STEP_SEQ_MAX_LENGTH][POLYPHONY];
-
-  juce::MidiMessageCollector arpMidiCollector;
-  double lastCallbackTime;
+
+  // both indexed by GetStepParameterIndex, resolved once in the constructor
+  juce::RangedAudioParameter* stepParams[NUM_STEP_PARAMETERS];
+  std::atomic<float>* stepParamValues[NUM_STEP_PARAMETERS];
+  float getStepParamValue(int step, StepField field, int note = 0) const {
+    return stepParamValues[GetStepParameterIndex(step, field, note)]->load();
+  }
+
+  // steps are only re-read when one of their parameters changed
+  // bit i of dirtySteps is set by the listener of step i on whatever thread
+  // changed the parameter, and cleared by applyParameters on the audio thread
+  static_assert(STEP_SEQ_MAX_LENGTH <= 64);
+  struct StepListener : juce::AudioProcessorValueTreeState::Listener {
+    std::atomic<std::uint64_t>* dirtySteps = nullptr;
+    const std::atomic<std::uint64_t>* publishingSteps = nullptr;
+    int step = 0;
+
+    void parameterChanged(const juce::String&, float) override {
+      auto bit = std::uint64_t{1} << step;
+      if (!(publishingSteps->load(std::memory_order_relaxed) & bit)) {
+        dirtySteps->fetch_or(bit, std::memory_order_release);
+      }
+    }
+  };
+  StepListener stepListeners[STEP_SEQ_MAX_LENGTH];
+  std::atomic<std::uint64_t> dirtySteps{~std::uint64_t{0}};
+
+  // live-recorded steps are written to the parameters on the message thread,
+  // the latest version of each step in one batch per timer callback and one
+  // undo transaction per recording pass
+  void timerCallback() override;
+  void publishRecordedSteps(std::uint64_t steps);
+  Sequencer::PolyStep<POLYPHONY> recordedSteps[STEP_SEQ_MAX_LENGTH];
+  std::uint32_t recordingPass = 0;
+
+  // whole patterns (a loaded state) are read from the parameters on the
+  // message thread and swapped in by the audio thread before it applies
+  // single step changes, so playback never sees half a pattern
+  using Pattern = Sequencer::PolyTrack<POLYPHONY>::Pattern;
+  Sequencer::SnapshotBuffer<Pattern> patternSnapshots;
+  void publishPattern();
+
+  // steps that loading state changes (or leaves to their defaults)
+  std::uint64_t getStepsChangedBy(const juce::ValueTree& state) const;
+
+  Sequencer::PolyStep<POLYPHONY> readStepParameters(int index) const;
+
+  // bit i set while the message thread writes the parameters of step i on
+  // behalf of the engine (a recorded step) or of a whole pattern, so that the
+  // listener of that step does not make the audio thread read it again
+  // changes to any other step (host automation) still get through
+  std::atomic<std::uint64_t> publishingSteps{0};
+
   // std::atomic<bool> bypassed;
 
   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioPluginAudioProcessor)
@@ -2,6 +2,7 @@
 #include "PolyArp/Part.h"
 #include "PolyArp/KeyboardState.h"
 #include "PolyArp/VoiceLimiter.h"
+#include <utility>
 
 // this class serve as a data management layer between the core sequencer logic
 // (Part.cpp) and global seq/arp business logic
@@ -14,52 +15,101 @@ static inline bool ApproximatelyEqual(float x, float y) {
   return std::abs(x - y) < 0.0001f;
 }
 
+// notes are packed into parallel arrays (one byte for number and velocity,
+// 1/960 step fixed point for offset and length) so that a 10 note step fits
+// in a single cache line
 template <int POLYPHONY>
 struct PolyStep {
+  static constexpr auto SIZE = static_cast<std::size_t>(POLYPHONY);
+
   bool enabled = false;
-  Note notes[POLYPHONY];
+  std::uint8_t numbers[SIZE];     // <= DISABLED_NOTE indicates disabled
+  std::uint8_t velocities[SIZE];  // 1..127
+  std::int16_t offsets[SIZE];     // in NOTE_TIME_UNITS_PER_STEP
+  std::uint16_t lengths[SIZE];    // in NOTE_TIME_UNITS_PER_STEP
+
+  Note getNote(int index) const {
+    return {.number = numbers[index],
+            .velocity = velocities[index],
+            .offset = UnpackNoteTime(offsets[index]),
+            .length = UnpackNoteTime(lengths[index])};
+  }
+
+  void setNote(int index, Note note) {
+    numbers[index] =
+        static_cast<std::uint8_t>(std::clamp(note.number, 0, 127));
+    velocities[index] =
+        static_cast<std::uint8_t>(std::clamp(note.velocity, 0, 127));
+    offsets[index] = PackNoteOffset(note.offset);
+    lengths[index] = PackNoteLength(note.length);
+  }
+
+  bool isNoteEnabled(int index) const {
+    return numbers[index] > DISABLED_NOTE;
+  }
+
+  void disableNote(int index) { numbers[index] = DISABLED_NOTE; }
 
   void reset() {
     enabled = false;
     // probability = 1.0;
-    for (auto& note : notes) {
-      note.reset();
+    Note note;
+    note.reset();
+    for (int i = 0; i < POLYPHONY; ++i) {
+      setNote(i, note);
     }
-    notes[0].number = DEFAULT_NOTE;
+    numbers[0] = DEFAULT_NOTE;
   }
 
+  // highest note first, insertion sort: O(n) when only one note moved
   void sortByNote() {
-    std::sort(std::begin(notes), std::end(notes),
-              [](const Note& a, const Note& b) { return a.number > b.number; });
+    for (int i = 1; i < POLYPHONY; ++i) {
+      for (int j = i; j > 0 && numbers[j - 1] < numbers[j]; --j) {
+        swapNotes(j - 1, j);
+      }
+    }
+  }
+
+  // playback order: earliest offset first, higher note first on a tie
+  void getOffsetOrder(std::uint8_t (&order)[SIZE]) const {
+    for (int i = 0; i < POLYPHONY; ++i) {
+      int j = i;
+      for (; j > 0 && isPlayedBefore(i, order[j - 1]); --j) {
+        order[j] = order[j - 1];
+      }
+      order[j] = static_cast<std::uint8_t>(i);
+    }
   }
 
-  void sortByOffset() {
-    std::sort(std::begin(notes), std::end(notes),
-              [](const Note& a, const Note& b) { return a.offset < b.offset; });
+  // true if both steps play their notes in the same order
+  bool hasSameOffsetOrder(const PolyStep& other) const {
+    return std::equal(std::begin(numbers), std::end(numbers),
+                      std::begin(other.numbers)) &&
+           std::equal(std::begin(offsets), std::end(offsets),
+                      std::begin(other.offsets));
   }
 
   void alignWith(Note other) {
-    for (auto& note : notes) {
-      note.velocity = other.velocity;
-      note.offset = other.offset;
-      note.length = other.length;
+    for (int i = 0; i < POLYPHONY; ++i) {
+      velocities[i] = static_cast<std::uint8_t>(other.velocity);
+      offsets[i] = PackNoteOffset(other.offset);
+      lengths[i] = PackNoteLength(other.length);
     }
   }
 
   bool isEmpty() const {
-    bool is_empty = true;
-    for (auto note : notes) {
-      if (note.number != DISABLED_NOTE) {
-        is_empty = false;
+    for (int i = 0; i < POLYPHONY; ++i) {
+      if (numbers[i] != DISABLED_NOTE) {
+        return false;
       }
     }
-    return is_empty;
+    return true;
   }
 
   void addNote(Note newNote, int maxNumNotes = POLYPHONY) {
     if (!enabled) {  // step enabled by realtime recording
       reset();
-      notes[0] = newNote;
+      setNote(0, newNote);
       alignWith(newNote);
       enabled = true;
       return;
@@ -67,47 +117,34 @@ struct PolyStep {
 
     // note: be consistent with voice stealing policy in VoiceLimiter
     // same note replacement -> free slot -> closest/latest note replacement
-    for (auto& note : notes) {
-      if (note.number == newNote.number) {
-        note = newNote;
+    for (int i = 0; i < POLYPHONY; ++i) {
+      if (numbers[i] == newNote.number) {
+        setNote(i, newNote);
         sortByNote();
         return;
       }
     }
 
     for (int i = 0; i < maxNumNotes; ++i) {
-      if (notes[i].number <= DISABLED_NOTE) {
-        notes[i] = newNote;
+      if (numbers[i] <= DISABLED_NOTE) {
+        setNote(i, newNote);
         sortByNote();
         return;
       }
     }
 
-    // replace latest note
-    // int latest_index = 0;
-    // float max_offset = notes[0].offset;
-    // for (int i = 1; i < maxNumNotes; ++i) {
-    //   if (notes[i].offset > max_offset) {
-    //     max_offset = notes[i].offset;
-    //     latest_index = i;
-    //   }
-    // }
-    // notes[latest_index] = newNote;
-    // sortByNote();
-    // return;
-
     // replace closest note
     int closest_index = 0;
     int closest_distance = 128;
 
     for (int i = 0; i < maxNumNotes; ++i) {
-      int distance = std::abs(notes[i].number - newNote.number);
+      int distance = std::abs(numbers[i] - newNote.number);
       if (distance < closest_distance) {
         closest_distance = distance;
         closest_index = i;
       }
     }
-    notes[closest_index] = newNote;
+    setNote(closest_index, newNote);
     sortByNote();
     return;
   }
@@ -115,28 +152,38 @@ struct PolyStep {
   int getLowestNoteNumber() const {
     int lowest = 128;
     for (int i = 0; i < POLYPHONY; ++i) {
-      if (notes[i].number < lowest && notes[i].number > DISABLED_NOTE) {
-        lowest = notes[i].number;
+      if (numbers[i] < lowest && numbers[i] > DISABLED_NOTE) {
+        lowest = numbers[i];
       }
     }
     return lowest;
   }
 
-  // void removeNote(int noteNumber) {
-  //   for (int i = 0; i < POLYPHONY; ++i) {
-  //     if (notes[i].number == noteNumber) {
-  //       notes[i].number = DISABLED_NOTE;
-  //     }
-  //   }
-
-  //   if (isEmpty()) {
-  //     reset();
-  //   } else {
-  //     sort();
-  //   }
-  // }
+  // earliest offset, never later than the step itself
+  int getMinOffset() const {
+    int offset_min = 0;
+    for (int i = 0; i < POLYPHONY; ++i) {
+      offset_min = std::min(offset_min, static_cast<int>(offsets[i]));
+    }
+    return offset_min;
+  }
 
   PolyStep() { reset(); }
+
+private:
+  void swapNotes(int a, int b) {
+    std::swap(numbers[a], numbers[b]);
+    std::swap(velocities[a], velocities[b]);
+    std::swap(offsets[a], offsets[b]);
+    std::swap(lengths[a], lengths[b]);
+  }
+
+  bool isPlayedBefore(int a, int b) const {
+    if (offsets[a] != offsets[b]) {
+      return offsets[a] < offsets[b];
+    }
+    return numbers[a] > numbers[b];
+  }
 };
 
 template <int POLYPHONY>
@@ -152,13 +199,41 @@ public:
         voiceLimiterRef(noteLimiter),
         interval_(0),
         overdub_(false),
-        rest_(false) {}
+        rest_(false),
+        overdubbedSteps_(0),
+        renderTicksPerStep_(0) {
+    for (int i = 0; i < STEP_SEQ_MAX_LENGTH; ++i) {
+      updateOffsetOrder(i);
+    }
+  }
 
-  StepType getStepAtIndex(int index) const { return steps_[index]; }
+  // every step of the track, for replacing them all at once
+  struct Pattern {
+    StepType steps[STEP_SEQ_MAX_LENGTH];
+  };
 
-  void setStepAtIndex(int index, StepType step) { steps_[index] = step; }
+  const StepType& getStepAtIndex(int index) const { return steps_[index]; }
 
-  void resetStepAtIndex(int index) { steps_[index].reset(); }
+  void setStepAtIndex(int index, const StepType& step) {
+    bool order_changed = !step.hasSameOffsetOrder(steps_[index]);
+    steps_[index] = step;
+    if (order_changed) {
+      updateOffsetOrder(index);
+    }
+    updateRenderTick(index);
+  }
+
+  void setPattern(const Pattern& pattern) {
+    for (int i = 0; i < STEP_SEQ_MAX_LENGTH; ++i) {
+      setStepAtIndex(i, pattern.steps[i]);
+    }
+  }
+
+  void resetStepAtIndex(int index) {
+    steps_[index].reset();
+    updateOffsetOrder(index);
+    updateRenderTick(index);
+  }
 
   // returns default note if there is not data in the track
   int getRootNoteNumber() const {
@@ -180,51 +255,92 @@ public:
 
   void setRest(bool enabled) { rest_ = enabled; }
 
+  // steps changed by overdub since the last call, bit i for step i
+  std::uint64_t takeOverdubbedSteps() {
+    return std::exchange(overdubbedSteps_, 0);
+  }
+
 private:
   StepType steps_[STEP_SEQ_MAX_LENGTH];
+  // note indices of each step in playback order, updated on edit so that
+  // renderStep never sorts
+  std::uint8_t offsetOrder_[STEP_SEQ_MAX_LENGTH][StepType::SIZE];
 
   const VoiceLimiter& voiceLimiterRef;
 
   int interval_;
   bool overdub_;
   bool rest_;
+  static_assert(STEP_SEQ_MAX_LENGTH <= 64);
+  std::uint64_t overdubbedSteps_;
+
+  void updateOffsetOrder(int index) {
+    steps_[index].getOffsetOrder(offsetOrder_[index]);
+  }
+
+  // earliest tick of every step, for the resolution in renderTicksPerStep_
+  // (0 until first used), so that the check on every tick is a lookup
+  // kept up to date on edit, recomputed only when the resolution changed
+  mutable int renderTicks_[STEP_SEQ_MAX_LENGTH];
+  mutable int renderTicksPerStep_;
+
+  void updateRenderTick(int index) const {
+    // same math as renderNote so that the earliest note on is never rendered
+    // late
+    float offset_min = UnpackNoteTime(steps_[index].getMinOffset());
+    renderTicks_[index] =
+        GetTickPosition(static_cast<float>(index) + offset_min,
+                        renderTicksPerStep_)
+            .tick;
+  }
 
   int getStepRenderTick(int index) const override final {
-    float offset_min = 0.0f;
-    for (int i = 0; i < POLYPHONY; ++i) {
-      offset_min = std::min(offset_min, steps_[index].notes[i].offset);
+    if (renderTicksPerStep_ != getTicksPerStep()) {
+      renderTicksPerStep_ = getTicksPerStep();
+      for (int i = 0; i < STEP_SEQ_MAX_LENGTH; ++i) {
+        updateRenderTick(i);
+      }
     }
-    return static_cast<int>((index + offset_min) * getTicksPerStep());
+    return renderTicks_[index];
   }
 
   void renderStep(int index) override final {
     auto& step = steps_[index];
+    const auto& order = offsetOrder_[index];
     if (step.enabled) {
       // overdub (modify step data based on actual voice usage)
       if (overdub_) {
+        auto step_bit = std::uint64_t{1} << index;
         if (rest_) {
-          step.reset();
+          overdubbedSteps_ |= step_bit;
+          resetStepAtIndex(index);
           return;
         }
 
         // warning: the order of evaluating tryNoteOn matters
-        step.sortByOffset();
-
-        for (auto& note : step.notes) {
-          if (note.number > DISABLED_NOTE) {
+        bool step_changed = false;
+        for (int i : order) {
+          if (step.isNoteEnabled(i)) {
             if (!voiceLimiterRef.tryNoteOn(
-                    note.number, Priority::Sequencer,
+                    step.numbers[i], Priority::Sequencer,
                     VoiceLimiter::StealingPolicy::Closest)) {
-              note.number = DISABLED_NOTE;
+              step.disableNote(i);
+              step_changed = true;
             }
           }
         }
 
         if (step.isEmpty()) {
-          step.reset();
+          overdubbedSteps_ |= step_bit;
+          resetStepAtIndex(index);
           return;
-        } else {
+        }
+
+        // rare: move disabled notes to the end
+        if (step_changed) {
+          overdubbedSteps_ |= step_bit;
           step.sortByNote();
+          updateOffsetOrder(index);
         }
       }
 
@@ -240,14 +356,9 @@ private:
 
       // render all notes in the step
       // order by offset for arp to play correctly
-      step.sortByOffset();
-
-      for (const auto& note : steps_[index].notes) {
-        // render note
-        renderNote(index, note.transposed(interval_));
+      for (int i : order) {
+        renderNote(index, step.getNote(i).transposed(interval_));
       }
-
-      step.sortByNote();
     }
   }
 };
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+
+// seedable PCG32 generator (M.E. O'Neill, pcg-random.org, Apache 2.0)
+// the same seed on a different stream gives an independent sequence, so one
+// seed can drive several decisions without them being correlated
+// 16 bytes of state, no locks, meant to be owned by one instance and thread
+
+namespace Sequencer {
+
+class RandomStream {
+public:
+  explicit RandomStream(std::uint64_t seed = 0, std::uint64_t stream = 0) {
+    setSeed(seed, stream);
+  }
+
+  void setSeed(std::uint64_t seed, std::uint64_t stream = 0) {
+    state_ = 0;
+    increment_ = (stream << 1) | 1;  // must be odd
+    next();
+    state_ += seed;
+    next();
+  }
+
+  std::uint32_t next() {
+    auto state = state_;
+    state_ = state * 6364136223846793005ull + increment_;
+    auto xorshifted = static_cast<std::uint32_t>(((state >> 18) ^ state) >> 27);
+    auto rotation = static_cast<std::uint32_t>(state >> 59);
+    return (xorshifted >> rotation) | (xorshifted << ((32 - rotation) & 31));
+  }
+
+  // uniform in [0, maxValue), maxValue > 0
+  int nextInt(int maxValue) {
+    return static_cast<int>((static_cast<std::uint64_t>(next()) *
+                             static_cast<std::uint32_t>(maxValue)) >>
+                            32);
+  }
+
+  bool nextBool() { return (next() >> 31) != 0; }
+
+private:
+  std::uint64_t state_;
+  std::uint64_t increment_;
+};
+
+}  // namespace Sequencer
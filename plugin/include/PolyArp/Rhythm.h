@@ -0,0 +1,166 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+
+// rhythms of up to 32 steps packed into a bitmask, bit i set if step i plays
+// the euclidean table is built at compile time with the same Bjorklund
+// algorithm as EuclideanPattern in script/yarns.py, the Yarns arpeggiator
+// patterns are parsed at compile time from the same xox strings
+
+#define RHYTHM_MAX_LENGTH 32
+#define YARNS_PATTERN_LENGTH 16
+#define YARNS_NUM_PATTERNS 22
+
+namespace Sequencer {
+
+// bit i of the result is step i of the Bjorklund pattern with fill pulses
+constexpr std::uint32_t BjorklundPattern(int fill, int length) {
+  // a group of steps is kept as its bits plus its length
+  struct Group {
+    std::uint32_t bits;
+    int length;
+  };
+
+  Group pattern[RHYTHM_MAX_LENGTH]{};
+  Group next[RHYTHM_MAX_LENGTH]{};
+  int size = length;
+  for (int i = 0; i < length; ++i) {
+    pattern[i] = {i < fill ? 1u : 0u, 1};
+  }
+
+  int k = fill;
+  while (k) {
+    int cut = std::min(k, size - k);
+    int n = 0;
+    for (int i = 0; i < cut; ++i) {
+      const auto& tail = pattern[k + i];
+      next[n++] = {pattern[i].bits | (tail.bits << pattern[i].length),
+                   pattern[i].length + tail.length};
+    }
+    for (int i = cut; i < k; ++i) {
+      next[n++] = pattern[i];
+    }
+    for (int i = k + cut; i < size; ++i) {
+      next[n++] = pattern[i];
+    }
+    for (int i = 0; i < n; ++i) {
+      pattern[i] = next[i];
+    }
+    size = n;
+    k = cut;
+  }
+
+  std::uint32_t mask = 0;
+  int position = 0;
+  for (int i = 0; i < size; ++i) {
+    mask |= pattern[i].bits << position;
+    position += pattern[i].length;
+  }
+  return mask;
+}
+
+// [length][fill], fill <= length
+inline constexpr auto EUCLIDEAN_PATTERNS = [] {
+  std::array<std::array<std::uint32_t, RHYTHM_MAX_LENGTH + 1>,
+             RHYTHM_MAX_LENGTH + 1>
+      table{};
+  for (int length = 1; length <= RHYTHM_MAX_LENGTH; ++length) {
+    for (int fill = 0; fill <= length; ++fill) {
+      table[static_cast<std::size_t>(length)][static_cast<std::size_t>(fill)] =
+          BjorklundPattern(fill, length);
+    }
+  }
+  return table;
+}();
+
+// 'o' plays, '-' rests, spaces are ignored, first character is step 0
+constexpr std::uint32_t XoxPattern(const char* xox) {
+  std::uint32_t mask = 0;
+  int step = 0;
+  for (; *xox; ++xox) {
+    if (*xox == ' ') {
+      continue;
+    }
+    if (*xox == 'o') {
+      mask |= 1u << step;
+    }
+    ++step;
+  }
+  return mask;
+}
+
+// arpeggiator_patterns of Mutable Instruments Yarns (Emilie Gillet, MIT)
+inline constexpr std::uint16_t YARNS_PATTERNS[YARNS_NUM_PATTERNS] = {
+    XoxPattern("o-o- o-o- o-o- o-o-"), XoxPattern("o-o- oooo o-o- oooo"),
+    XoxPattern("o-o- oo-o o-o- oo-o"), XoxPattern("o-o- o-oo o-o- o-oo"),
+    XoxPattern("o-o- o-o- oo-o -o-o"), XoxPattern("o-o- o-o- o--o o-o-"),
+    XoxPattern("o-o- o--o o-o- o--o"),
+
+    XoxPattern("o--o ---- o--o ----"), XoxPattern("o--o --o- -o-- o--o"),
+    XoxPattern("o--o --o- -o-- o-o-"), XoxPattern("o--o --o- o--o --o-"),
+    XoxPattern("o--o o--- o-o- o-oo"),
+
+    XoxPattern("oo-o -oo- oo-o -oo-"), XoxPattern("oo-o o-o- oo-o o-o-"),
+
+    XoxPattern("ooo- ooo- ooo- ooo-"), XoxPattern("ooo- oo-o o-oo -oo-"),
+    XoxPattern("ooo- o-o- ooo- o-o-"),
+
+    XoxPattern("oooo -oo- oooo -oo-"), XoxPattern("oooo o-oo -oo- ooo-"),
+
+    XoxPattern("o--- o--- o--o -o-o"), XoxPattern("o--- --oo oooo -oo-"),
+    XoxPattern("o--- ---- o--- o-oo")};
+
+class Rhythm {
+public:
+  // every step plays
+  constexpr Rhythm() : Rhythm(1, 1) {}
+
+  constexpr Rhythm(std::uint32_t mask, int length)
+      : mask_{mask},
+        length_{length},
+        twoPeriods_{mask | (static_cast<std::uint64_t>(mask) << length)} {}
+
+  // step i plays step (i + rotation) of the Bjorklund pattern
+  static constexpr Rhythm Euclidean(int fill, int length, int rotation = 0) {
+    length = std::clamp(length, 1, RHYTHM_MAX_LENGTH);
+    fill = std::clamp(fill, 0, length);
+    rotation = (rotation % length + length) % length;
+
+    std::uint64_t pattern =
+        EUCLIDEAN_PATTERNS[static_cast<std::size_t>(length)]
+                          [static_cast<std::size_t>(fill)];
+    std::uint64_t rotated =
+        (pattern >> rotation) | (pattern << (length - rotation));
+    return {static_cast<std::uint32_t>(rotated & ((1ull << length) - 1)),
+            length};
+  }
+
+  // pattern in [0, YARNS_NUM_PATTERNS)
+  static constexpr Rhythm Yarns(int pattern) {
+    pattern = std::clamp(pattern, 0, YARNS_NUM_PATTERNS - 1);
+    return {YARNS_PATTERNS[pattern], YARNS_PATTERN_LENGTH};
+  }
+
+  constexpr std::uint32_t getMask() const { return mask_; }
+  constexpr int getLength() const { return length_; }
+
+  // index counts steps from the start of the rhythm and may exceed length
+  constexpr bool isPulse(int index) const {
+    return (mask_ >> (index % length_)) & 1u;
+  }
+
+  // steps from index to the next pulse after it, 0 if the rhythm is silent
+  constexpr int getStepsToNextPulse(int index) const {
+    auto ahead = twoPeriods_ >> (index % length_ + 1);
+    return ahead ? std::countr_zero(ahead) + 1 : 0;
+  }
+
+private:
+  std::uint32_t mask_;
+  int length_;
+  std::uint64_t twoPeriods_;  // back to back, the next pulse never wraps
+};
+
+}  // namespace Sequencer
@@ -0,0 +1,57 @@
+#pragma once
+#include <atomic>
+#include <type_traits>
+
+// hands complete versions of a value from one writer thread to one reader
+// thread, neither ever blocks (triple buffering)
+// the writer fills its own copy and publishes it with a single atomic
+// exchange, the reader picks up the latest published version whenever it is
+// at a safe point. a copy is only written again once the reader has let go of
+// it, so nothing is ever read half written and nothing is allocated after
+// construction
+
+namespace Sequencer {
+
+template <typename T>
+class SnapshotBuffer {
+  static_assert(std::is_trivially_copyable_v<T>);
+
+public:
+  SnapshotBuffer() : writeIndex_(0), middle_(1), readIndex_(2) {}
+
+  // writer side
+  // the copy being built, it still holds whatever was written into it before
+  // (not necessarily the last published version)
+  T& getWriteBuffer() { return buffers_[writeIndex_]; }
+
+  void publish() {
+    auto spare =
+        middle_.exchange(writeIndex_ | FRESH, std::memory_order_acq_rel);
+    writeIndex_ = spare & INDEX_MASK;
+  }
+
+  // reader side
+  // move to the latest published version, return false if there is none since
+  // the last call
+  bool update() {
+    if (!(middle_.load(std::memory_order_relaxed) & FRESH)) {
+      return false;
+    }
+    auto latest = middle_.exchange(readIndex_, std::memory_order_acq_rel);
+    readIndex_ = latest & INDEX_MASK;
+    return true;
+  }
+
+  const T& read() const { return buffers_[readIndex_]; }
+
+private:
+  static constexpr int INDEX_MASK = 3;
+  static constexpr int FRESH = 4;  // set while middle_ is newer than the reader
+
+  int writeIndex_;           // owned by the writer
+  std::atomic<int> middle_;  // index of the spare copy, plus FRESH
+  int readIndex_;            // owned by the reader
+  T buffers_[3]{};
+};
+
+}  // namespace Sequencer
@@ -0,0 +1,95 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include "PolyArp/ArpSeq.h"
+
+// every step parameter has a fixed integer index, in the order they are added
+// to the parameter layout: step by step, ENABLED first, then NOTE, VELOCITY,
+// OFFSET, LENGTH of note 0, of note 1 and so on
+// the string IDs ("S12_N3_VELOCITY") are built once at compile time, so
+// nothing needs to concatenate strings to find a step parameter
+
+namespace audio_plugin {
+
+enum class StepField { Enabled, Note, Velocity, Offset, Length };
+
+inline constexpr int NOTE_FIELDS_PER_NOTE = 4;
+inline constexpr int STEP_PARAMETERS_PER_STEP =
+    1 + POLYPHONY * NOTE_FIELDS_PER_NOTE;
+inline constexpr int NUM_STEP_PARAMETERS =
+    STEP_SEQ_MAX_LENGTH * STEP_PARAMETERS_PER_STEP;
+
+// note is ignored for StepField::Enabled
+constexpr int GetStepParameterIndex(int step, StepField field, int note = 0) {
+  int offset = 0;
+  if (field != StepField::Enabled) {
+    offset = 1 + note * NOTE_FIELDS_PER_NOTE + static_cast<int>(field) -
+             static_cast<int>(StepField::Note);
+  }
+  return step * STEP_PARAMETERS_PER_STEP + offset;
+}
+
+constexpr int GetStepOfParameter(int index) {
+  return index / STEP_PARAMETERS_PER_STEP;
+}
+
+// long enough for "S99_N99_VELOCITY"
+struct StepParameterID {
+  char text[20];
+};
+
+static_assert(STEP_SEQ_MAX_LENGTH <= 100 && POLYPHONY <= 100);
+
+namespace detail {
+constexpr void AppendText(StepParameterID& id, int& length, const char* text) {
+  for (; *text; ++text) {
+    id.text[length++] = *text;
+  }
+}
+
+constexpr void AppendNumber(StepParameterID& id, int& length, int number) {
+  if (number >= 10) {
+    id.text[length++] = static_cast<char>('0' + number / 10);
+  }
+  id.text[length++] = static_cast<char>('0' + number % 10);
+}
+}  // namespace detail
+
+// indexed by GetStepParameterIndex
+inline constexpr auto STEP_PARAMETER_IDS = [] {
+  std::array<StepParameterID, NUM_STEP_PARAMETERS> ids{};
+  constexpr const char* FIELD_NAMES[] = {"NOTE", "VELOCITY", "OFFSET",
+                                         "LENGTH"};
+  std::size_t index = 0;
+  for (int step = 0; step < STEP_SEQ_MAX_LENGTH; ++step) {
+    int length = 0;
+    detail::AppendText(ids[index], length, "S");
+    detail::AppendNumber(ids[index], length, step);
+    detail::AppendText(ids[index], length, "_ENABLED");
+    ++index;
+
+    for (int note = 0; note < POLYPHONY; ++note) {
+      for (auto field_name : FIELD_NAMES) {
+        length = 0;
+        detail::AppendText(ids[index], length, "S");
+        detail::AppendNumber(ids[index], length, step);
+        detail::AppendText(ids[index], length, "_N");
+        detail::AppendNumber(ids[index], length, note);
+        detail::AppendText(ids[index], length, "_");
+        detail::AppendText(ids[index], length, field_name);
+        ++index;
+      }
+    }
+  }
+  return ids;
+}();
+
+constexpr const char* GetStepParameterID(int step,
+                                         StepField field,
+                                         int note = 0) {
+  return STEP_PARAMETER_IDS[static_cast<std::size_t>(
+                                GetStepParameterIndex(step, field, note))]
+      .text;
+}
+
+}  // namespace audio_plugin
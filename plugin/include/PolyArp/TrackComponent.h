@@ -16,7 +16,7 @@ namespace audio_plugin {
 class PolyTrackComponent : public juce::Component, private juce::Timer {
 public:
   PolyTrackComponent(AudioPluginAudioProcessor& p)
-      : processorRef(p), trackRef(p.arpseq.getSeq()) {
+      : processorRef(p) {
     startTimer(10);
 
     setCollapsed(true);
@@ -75,12 +75,9 @@ public:
                                        BUTTON_WIDTH, KNOB_TEXT_HEIGHT);
       // set velocity of all notes inside the step
       velocityKnobs[i].onValueChange = [this, i]() {
-        juce::String prefix = "S" + juce::String(i) + "_";
-
         for (int j = 1; j < POLYPHONY; ++j) {
-          juce::String note_signifier = "N" + juce::String(j) + "_";
-          auto other_velocity = processorRef.parameters.getParameter(
-              prefix + note_signifier + "VELOCITY");
+          auto other_velocity =
+              processorRef.getStepParameter(i, StepField::Velocity, j);
           other_velocity->setValueNotifyingHost(other_velocity->convertTo0to1(
               static_cast<float>(velocityKnobs[i].getValue())));
         }
@@ -97,12 +94,9 @@ public:
       offsetKnobs[i].setTextBoxStyle(juce::Slider::TextBoxBelow, false,
                                      BUTTON_WIDTH, KNOB_TEXT_HEIGHT);
       offsetKnobs[i].onValueChange = [this, i]() {
-        juce::String prefix = "S" + juce::String(i) + "_";
-
         for (int j = 1; j < POLYPHONY; ++j) {
-          juce::String note_signifier = "N" + juce::String(j) + "_";
-          auto other_offset = processorRef.parameters.getParameter(
-              prefix + note_signifier + "OFFSET");
+          auto other_offset =
+              processorRef.getStepParameter(i, StepField::Offset, j);
           other_offset->setValueNotifyingHost(other_offset->convertTo0to1(
               static_cast<float>(offsetKnobs[i].getValue())));
         }
@@ -121,12 +115,9 @@ public:
                                      BUTTON_WIDTH, KNOB_TEXT_HEIGHT);
 
       lengthKnobs[i].onValueChange = [this, i]() {
-        juce::String prefix = "S" + juce::String(i) + "_";
-
         for (int j = 1; j < POLYPHONY; ++j) {
-          juce::String note_signifier = "N" + juce::String(j) + "_";
-          auto other_offset = processorRef.parameters.getParameter(
-              prefix + note_signifier + "LENGTH");
+          auto other_offset =
+              processorRef.getStepParameter(i, StepField::Length, j);
           other_offset->setValueNotifyingHost(other_offset->convertTo0to1(
               static_cast<float>(lengthKnobs[i].getValue())));
         }
@@ -136,34 +127,34 @@ public:
 
     // MARK: attachments
     for (int i = 0; i < STEP_SEQ_MAX_LENGTH; ++i) {
-      juce::String prefix = "S" + juce::String(i) + "_";
-
       enableAttachments[i] = std::make_unique<ButtonAttachment>(
-          processorRef.parameters, prefix + "ENABLED", stepButtons[i]);
+          processorRef.parameters, GetStepParameterID(i, StepField::Enabled),
+          stepButtons[i]);
 
       for (int j = 0; j < POLYPHONY; ++j) {
-        juce::String note_signifier = "N" + juce::String(j) + "_";
-
         noteAttachments[i][j] = std::make_unique<SliderAttachment>(
-            processorRef.parameters, prefix + note_signifier + "NOTE",
+            processorRef.parameters, GetStepParameterID(i, StepField::Note, j),
             noteKnobs[i][j]);
       }
 
       // note: bind to note 0 parameter, and use onValueChange to update other
       // note parameters
       velocityAttachments[i] = std::make_unique<SliderAttachment>(
-          processorRef.parameters, prefix + "N0_VELOCITY", velocityKnobs[i]);
+          processorRef.parameters, GetStepParameterID(i, StepField::Velocity),
+          velocityKnobs[i]);
 
       offsetAttachments[i] = std::make_unique<SliderAttachment>(
-          processorRef.parameters, prefix + "N0_OFFSET", offsetKnobs[i]);
+          processorRef.parameters, GetStepParameterID(i, StepField::Offset),
+          offsetKnobs[i]);
 
       lengthAttachments[i] = std::make_unique<SliderAttachment>(
-          processorRef.parameters, prefix + "N0_LENGTH", lengthKnobs[i]);
+          processorRef.parameters, GetStepParameterID(i, StepField::Length),
+          lengthKnobs[i]);
     }
   }
 
   void timerCallback() override final {
-    int playhead_index = trackRef.getCurrentStepIndex();
+    int playhead_index = processorRef.arpseq.getSequencerStepIndex();
 
     for (int i = 0; i < STEP_SEQ_MAX_LENGTH; ++i) {
       if (i == playhead_index) {
@@ -218,7 +209,6 @@ public:
 
 private:
   AudioPluginAudioProcessor& processorRef;
-  Sequencer::Part& trackRef;
   bool collapsed_;
 
   void setCollapsed(bool collapsed) {
@@ -1,142 +1,346 @@
-// Copyright 2012 Emilie Gillet.
-//
-// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
-//
-// Permission is hereby granted, free of charge, to any person obtaining a copy
-// of this software and associated documentation files (the "Software"), to deal
-// in the Software without restriction, including without limitation the rights
-// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
-// copies of the Software, and to permit persons to whom the Software is
-// furnished to do so, subject to the following conditions:
-//
-// The above copyright notice and this permission notice shall be included in
-// all copies or substantial portions of the Software.
-//
-// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
-// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
-// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
-// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
-// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
-// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
-// THE SOFTWARE.
-//
-// See http://creativecommons.org/licenses/MIT/ for more information.
-//
-// -----------------------------------------------------------------------------
-//
-// Polyphonic voice allocator.
-
 #pragma once
+#include "PolyArp/NoteSet.h"
+#include <cstddef>
+#include <cstdint>
 
-#include <cstring>
-#include <stdint.h>
-
-namespace stmlib {
+// polyphonic voice allocator with priority classes and dynamic polyphony
+// grew out of the stmlib VoiceAllocator (Copyright 2012 Emilie Gillet, MIT)
+// and the former deque based VoiceLimiter
+//
+// every voice has a fixed physical index in [0, CAPACITY). active voices are
+// chained into a doubly linked list in note on order, released voices queue
+// up in a free list so that the voice released the longest time ago is
+// reused first (its release tail had the most time to fade out)
+// nothing is allocated after construction
 
-enum VoiceAllocatorFlags { NOT_ALLOCATED = 0xff, ACTIVE_NOTE = 0x80 };
+namespace Sequencer {
 
-enum VoiceStealingMode { VOICE_STEALING_MODE_LRU, VOICE_STEALING_MODE_MRU };
+// larger value, higher priority
+enum class Priority { Keyboard = 1, Sequencer = 0 };
 
-template <uint8_t capacity>
+template <int CAPACITY>
 class VoiceAllocator {
+  static_assert(CAPACITY > 0 && CAPACITY <= 128);
+
+  struct Voice;
+
 public:
-  VoiceAllocator() {}
+  enum class StealingPolicy { LRU, MRU, Closest };
+
+  static constexpr int NO_VOICE = -1;
+
+  explicit VoiceAllocator(size_t numVoices = static_cast<size_t>(CAPACITY))
+      : numVoices_{numVoices}, numVoicesCached_{numVoices} {
+    reset();
+  }
 
-  void Init() {
-    size_ = 0;
-    Clear();
+  // Caveat: when setNumVoices reduces polyphony (e.g. 10 -> 5)
+  // note offs will not be properly be issued, the caller is responsible to
+  // note off those voices
+  // voices with an index >= numVoices are retired once they are released
+  void setNumVoices(size_t numVoices) {
+    numVoices_ = numVoices;
+    rebuildFreeList();
   }
 
-  uint8_t NoteOn(
-      uint8_t note,
-      VoiceStealingMode voice_stealing_mode = VOICE_STEALING_MODE_LRU) {
-    if (size_ == 0) {
-      return NOT_ALLOCATED;
+  size_t getNumVoices() const { return numVoices_; }
+
+  void setBypass(bool enabled) {
+    if (enabled) {
+      numVoicesCached_ = numVoices_;
+      setNumVoices(static_cast<size_t>(CAPACITY));
+    } else {
+      setNumVoices(numVoicesCached_);
+    }
+  }
+
+  // forget every voice without issuing note offs
+  void reset() {
+    for (auto& voice : noteToVoice_) {
+      voice = NO_VOICE;
+    }
+    for (auto& voice : voices_) {
+      voice.active = false;
     }
+    for (auto& notes : notesByPriority_) {
+      notes.clear();
+    }
+    numActive_ = 0;
+    head_ = tail_ = NO_VOICE;
+    nextAge_ = 0;
+    rebuildFreeList();
+  }
 
-    // First, check if there is a voice currently playing this note. In this
-    // case, this voice will be responsible for retriggering this note.
-    // Hint: if you're more into string instruments than keyboard instruments,
-    // you can safely comment those lines.
-    uint8_t voice = Find(note);
+  bool tryNoteOn(int noteNumber,
+                 Priority priority,
+                 StealingPolicy policy) const {
+    return pickVoice(noteNumber, priority, policy) != NO_VOICE;
+  }
 
-    // Then, try to find the least recently touched, currently inactive voice.
-    if (voice == NOT_ALLOCATED) {
-      for (uint8_t i = 0; i < capacity; ++i) {
-        if (lru_[i] < size_ && !(pool_[lru_[i]] & ACTIVE_NOTE)) {
-          voice = lru_[i];
-        }
-      }
+  // return true if sucessfully allocated
+  // stolenNote is not written if no note stealing happens (retriggering the
+  // same note counts as stealing it)
+  // voiceIndex receives the physical voice playing the note
+  bool noteOn(int noteNumber,
+              Priority priority,
+              StealingPolicy policy,
+              int* stolenNote = nullptr,
+              int* voiceIndex = nullptr) {
+    int voice = pickVoice(noteNumber, priority, policy);
+    if (voice == NO_VOICE) {
+      return false;
     }
-    // If all voices are active, use the least or most recently played note
-    // (voice-stealing).
-    if (voice == NOT_ALLOCATED) {
-      for (uint8_t i = 0; i < capacity; ++i) {
-        uint8_t candidate = voice_stealing_mode == VOICE_STEALING_MODE_LRU
-                                ? i
-                                : capacity - 1 - i;
-        if (lru_[candidate] < size_) {
-          voice = lru_[candidate];
-        }
+
+    if (voices_[voice].active) {
+      if (stolenNote) {
+        *stolenNote = voices_[voice].note;
       }
+      unlinkActive(voice);
+    } else {
+      popFreeVoice();
     }
-    pool_[voice] = note | ACTIVE_NOTE;
-    Touch(voice);
-    return voice;
+    linkActive(voice, noteNumber, priority);
+
+    if (voiceIndex) {
+      *voiceIndex = voice;
+    }
+    return true;
   }
 
-  uint8_t NoteOff(uint8_t note) {
-    uint8_t voice = Find(note);
-    if (voice != NOT_ALLOCATED) {
-      pool_[voice] &= 0x7f;
-      Touch(voice);
+  // return true if note successfully released
+  bool noteOff(int noteNumber, Priority priority, int* voiceIndex = nullptr) {
+    int voice = noteToVoice_[noteNumber];
+
+    if (voice != NO_VOICE) {
+      // do not note off if voice is used by higher priority source
+      if (voices_[voice].priority > priority) {
+        return false;
+      }
+
+      unlinkActive(voice);
+      pushFreeVoice(voice);
+      if (voiceIndex) {
+        *voiceIndex = voice;
+      }
+      return true;
     }
-    return voice;
+
+    return false;  // not found, technically this should not happen though
+  }
+
+  // NO_VOICE if the note is not playing
+  int getVoiceForNote(int noteNumber) const {
+    return noteToVoice_[noteNumber];
+  }
+
+  size_t getNumActiveVoices() const {
+    return static_cast<size_t>(numActive_);
   }
 
-  uint8_t Find(uint8_t note) const {
-    for (uint8_t i = 0; i < size_; ++i) {
-      if ((pool_[i] & 0x7f) == note) {
-        return i;
+  // iterate active notes from least to most recently used
+  // the range is invalidated by noteOn/noteOff
+  class ActiveNotes {
+  public:
+    class Iterator {
+    public:
+      Iterator(const Voice* voices, int voice)
+          : voices_(voices), voice_(voice) {}
+      int operator*() const { return voices_[voice_].note; }
+      Iterator& operator++() {
+        voice_ = voices_[voice_].next;
+        return *this;
+      }
+      bool operator!=(const Iterator& other) const {
+        return voice_ != other.voice_;
       }
+
+    private:
+      const Voice* voices_;
+      int voice_;
+    };
+
+    ActiveNotes(const Voice* voices, int head) : voices_(voices), head_(head) {}
+    Iterator begin() const { return {voices_, head_}; }
+    Iterator end() const { return {voices_, NO_VOICE}; }
+
+  private:
+    const Voice* voices_;
+    int head_;
+  };
+
+  ActiveNotes getActiveNotes() const { return {voices_, head_}; }
+
+private:
+  struct Voice {
+    std::uint32_t age;  // note on order, wraps around
+    std::int16_t prev;  // towards least-recently used
+    std::int16_t next;  // towards most-recently used (or next free voice)
+    std::int16_t note;
+    Priority priority;
+    bool active;
+  };
+
+  Voice voices_[static_cast<size_t>(CAPACITY)];
+  std::int16_t noteToVoice_[128];
+  NoteSet notesByPriority_[2];  // active notes of each priority
+  int numActive_;
+  int head_;      // least-recently used
+  int tail_;      // most-recently used
+  int freeHead_;  // released the longest time ago
+  int freeTail_;
+  std::uint32_t nextAge_;
+  size_t numVoices_;
+  size_t numVoicesCached_;
+
+  static int priorityIndex(Priority priority) {
+    return static_cast<int>(priority);
+  }
+
+  // the voice noteOn would use, without touching anything
+  int pickVoice(int noteNumber,
+                Priority priority,
+                StealingPolicy policy) const {
+    // retrigger same note from same or higher priority
+    int voice = noteToVoice_[noteNumber];
+    if (voice != NO_VOICE) {
+      return voices_[voice].priority <= priority ? voice : NO_VOICE;
+    }
+
+    // voice available
+    if (getNumActiveVoices() < numVoices_ && freeHead_ != NO_VOICE) {
+      return freeHead_;
+    }
+
+    // steal a note with priority <= incoming
+    switch (policy) {
+      case StealingPolicy::LRU:
+        return findOldest(priority);
+      case StealingPolicy::MRU:
+        return findNewest(priority);
+      case StealingPolicy::Closest:
+        return findClosest(noteNumber, priority);
     }
-    return NOT_ALLOCATED;
+    return NO_VOICE;
   }
 
-  void Clear() {
-    memset(&pool_, 0, sizeof(pool_));
-    for (uint8_t i = 0; i < capacity; ++i) {
-      lru_[i] = capacity - i - 1;
+  void linkActive(int voice, int noteNumber, Priority priority) {
+    auto& v = voices_[voice];
+    v.age = nextAge_++;
+    v.prev = static_cast<std::int16_t>(tail_);
+    v.next = NO_VOICE;
+    v.note = static_cast<std::int16_t>(noteNumber);
+    v.priority = priority;
+    v.active = true;
+
+    if (tail_ == NO_VOICE) {
+      head_ = voice;
+    } else {
+      voices_[tail_].next = static_cast<std::int16_t>(voice);
     }
+    tail_ = voice;
+
+    noteToVoice_[noteNumber] = static_cast<std::int16_t>(voice);
+    notesByPriority_[priorityIndex(priority)].insert(noteNumber);
+    ++numActive_;
   }
 
-  inline void ClearNotes() {
-    for (uint8_t i = 0; i < capacity; ++i) {
-      pool_[i] &= 0x7f;
+  void unlinkActive(int voice) {
+    auto& v = voices_[voice];
+
+    if (v.prev == NO_VOICE) {
+      head_ = v.next;
+    } else {
+      voices_[v.prev].next = v.next;
+    }
+    if (v.next == NO_VOICE) {
+      tail_ = v.prev;
+    } else {
+      voices_[v.next].prev = v.prev;
     }
+
+    noteToVoice_[v.note] = NO_VOICE;
+    notesByPriority_[priorityIndex(v.priority)].erase(v.note);
+    v.active = false;
+    --numActive_;
   }
 
-  inline void set_size(uint8_t size) { size_ = size; }
+  void pushFreeVoice(int voice) {
+    if (static_cast<size_t>(voice) >= numVoices_) {
+      return;  // retired by setNumVoices
+    }
+    voices_[voice].next = NO_VOICE;
+    if (freeTail_ == NO_VOICE) {
+      freeHead_ = voice;
+    } else {
+      voices_[freeTail_].next = static_cast<std::int16_t>(voice);
+    }
+    freeTail_ = voice;
+  }
 
-  inline uint8_t size() const { return size_; }
+  void popFreeVoice() {
+    freeHead_ = voices_[freeHead_].next;
+    if (freeHead_ == NO_VOICE) {
+      freeTail_ = NO_VOICE;
+    }
+  }
 
-private:
-  void Touch(uint8_t voice) {
-    int8_t source = capacity - 1;
-    int8_t destination = capacity - 1;
-    while (source >= 0) {
-      if (lru_[source] != voice) {
-        lru_[destination--] = lru_[source];
+  void rebuildFreeList() {
+    freeHead_ = freeTail_ = NO_VOICE;
+    for (int voice = 0; voice < CAPACITY; ++voice) {
+      if (!voices_[voice].active) {
+        pushFreeVoice(voice);
+      }
+    }
+  }
+
+  // O(n) worst case, but the first voice usually qualifies
+  int findOldest(Priority priority) const {
+    for (int voice = head_; voice != NO_VOICE; voice = voices_[voice].next) {
+      if (voices_[voice].priority <= priority) {
+        return voice;
+      }
+    }
+    return NO_VOICE;
+  }
+
+  int findNewest(Priority priority) const {
+    for (int voice = tail_; voice != NO_VOICE; voice = voices_[voice].prev) {
+      if (voices_[voice].priority <= priority) {
+        return voice;
       }
-      --source;
     }
-    lru_[0] = voice;
+    return NO_VOICE;
   }
 
-  uint8_t pool_[capacity];
-  // Holds the indices of the voices sorted by most recent usage.
-  uint8_t lru_[capacity];
-  uint8_t size_;
+  // closest note with priority <= incoming, the older voice wins a tie
+  int findClosest(int noteNumber, Priority priority) const {
+    NoteSet candidates;
+    for (int p = 0; p <= priorityIndex(priority); ++p) {
+      candidates |= notesByPriority_[p];
+    }
+
+    int lower = candidates.lowerThan(noteNumber);
+    int higher = candidates.higherThan(noteNumber);
+    if (lower == NoteSet::NONE) {
+      return higher == NoteSet::NONE ? NO_VOICE : noteToVoice_[higher];
+    }
+    if (higher == NoteSet::NONE) {
+      return noteToVoice_[lower];
+    }
+
+    int lower_voice = noteToVoice_[lower];
+    int higher_voice = noteToVoice_[higher];
+    int lower_distance = noteNumber - lower;
+    int higher_distance = higher - noteNumber;
+    if (lower_distance != higher_distance) {
+      return lower_distance < higher_distance ? lower_voice : higher_voice;
+    }
+    return isOlder(lower_voice, higher_voice) ? lower_voice : higher_voice;
+  }
+
+  bool isOlder(int a, int b) const {
+    return static_cast<std::int32_t>(voices_[a].age - voices_[b].age) < 0;
+  }
 };
 
-}  // namespace stmlib
+}  // namespace Sequencer
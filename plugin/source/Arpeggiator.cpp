@@ -2,51 +2,30 @@
 
 namespace Sequencer {
 
-// reference: https://paulbatchelor.github.io/sndkit/euclid/
-inline bool euclid_simple(int p, int n, int r, int i) {
-  return (((p * (i + r)) % n) + p) >= n;
-}
-
-// int euclid_simple_2(int p, int n, int r, int i) {
-//   return (p * (i + r)) % n < p;
-// }
-
 inline int positive_modulo(int i, int n) {
   return (i % n + n) % n;
 }
 
-template <class T>
-void RemoveDuplicatesInVector(std::vector<T>& vec) {
-  std::sort(vec.begin(), vec.end());
-  vec.erase(std::unique(vec.begin(), vec.end()), vec.end());
-}
-
-template <typename T>
-void FastShuffle(std::vector<T>& array, juce::Random& rng) {
-  for (int i = static_cast<int>(array.size()) - 1; i > 0; --i) {
-    int j = rng.nextInt(i + 1);  // 0 ≤ j ≤ i
-    std::swap(array[static_cast<size_t>(i)], array[static_cast<size_t>(j)]);
+// partial Fisher-Yates: the first count entries become a uniform draw
+// without replacement, count == size shuffles the whole array
+inline void PartialShuffle(int* array,
+                           int size,
+                           int count,
+                           RandomStream& random) {
+  for (int i = 0; i < std::min(count, size - 1); ++i) {
+    int j = i + random.nextInt(size - i);  // i ≤ j < size
+    std::swap(array[i], array[j]);
   }
 }
 
 // helper to render arp note with velocity, euclid legato and transpose
 void Arpeggiator::renderArpNote(int index, int note_number) {
-  int euclid_index = index % euclidLength_;
-
-  // if (type_ == ArpType::Gacha) {
-  //   euclid_index = index % patternLength_;
-  // }
-
   float note_length = gate_;
 
-  // euclid legato
+  // euclid legato: hold over the rests up to the next pulse
   if (euclidLegato_) {
-    euclid_index = (euclid_index + 1) % euclidLength_;
-    while (!euclid_simple(euclidFill_, euclidLength_, euclidRotate_,
-                          euclid_index)) {
-      note_length += 1.f;
-      euclid_index = (euclid_index + 1) % euclidLength_;
-    }
+    note_length +=
+        static_cast<float>(getRhythm().getStepsToNextPulse(index) - 1);
   }
 
   auto note = Note{.number = note_number + 12 * currentOctave_,
@@ -62,20 +41,26 @@ void Arpeggiator::shuffleNotesWithOctave() {
     return;
   }
 
-  shuffledNoteList_ = keyboard_.getNoteStack();
-
-  auto note_list_copy = shuffledNoteList_;
+  // octave copies of the held notes, sorted and deduplicated by a bitmask
+  std::uint64_t notes[3] = {0, 0, 0};
+  for (int note : keyboard_.getNoteStack()) {
+    for (int n = note; n < note + 12 * octave_; n += 12) {
+      notes[n >> 6] |= std::uint64_t{1} << (n & 63);
+    }
+  }
 
-  for (int i = 1; i < octave_; ++i) {
-    for (auto& n : note_list_copy) {
-      n += 12;
+  numShuffledNotes_ = 0;
+  for (int word = 0; word < 3; ++word) {
+    for (auto bits = notes[word]; bits != 0; bits &= bits - 1) {
+      shuffledNotes_[numShuffledNotes_++] = word * 64 + std::countr_zero(bits);
     }
-    shuffledNoteList_.insert(shuffledNoteList_.end(), note_list_copy.begin(),
-                             note_list_copy.end());
   }
 
-  RemoveDuplicatesInVector(shuffledNoteList_);
-  FastShuffle(shuffledNoteList_, juce::Random::getSystemRandom());
+  drawShuffledNotes(numShuffledNotes_);
+}
+
+void Arpeggiator::drawShuffledNotes(int count) {
+  PartialShuffle(shuffledNotes_, numShuffledNotes_, count, noteRandom_);
 }
 
 void Arpeggiator::generateRandomPatternWithOctave() {
@@ -83,173 +68,229 @@ void Arpeggiator::generateRandomPatternWithOctave() {
     return;
   }
 
-  std::vector<int> note_pool = keyboard_.getNoteStack();
-  note_pool.push_back(keyboard_.getLowestNote());    // favor lowest note
-  note_pool.push_back(keyboard_.getEarliestNote());  // favor first note
+  // the pool is the note stack plus the lowest and the first note again to
+  // favor them, drawn from without copying it
+  const auto& note_stack = keyboard_.getNoteStack();
+  int num_notes = static_cast<int>(note_stack.size());
 
   for (size_t i = 0; i < 16; ++i) {
-    int note_index = juce::Random::getSystemRandom().nextInt(
-        static_cast<int>(note_pool.size()));
+    int note_index = noteRandom_.nextInt(num_notes + 2);
 
-    notePattern_[i] = note_pool[static_cast<size_t>(note_index)];
+    if (note_index < num_notes) {
+      notePattern_[i] = note_stack[static_cast<size_t>(note_index)];
+    } else if (note_index == num_notes) {
+      notePattern_[i] = keyboard_.getLowestNote();
+    } else {
+      notePattern_[i] = keyboard_.getEarliestNote();
+    }
 
     int octave = 0;
-    // if (juce::Random::getSystemRandom().nextBool()) {
-    octave = juce::Random::getSystemRandom().nextInt(4);
+    // if (octaveRandom_.nextBool()) {
+    octave = octaveRandom_.nextInt(4);
     // }
 
     octavePattern_[i] = octave;
   }
 }
 
-int Arpeggiator::getAdjacentArpNote(bool repeat_boundary) {
-  auto arp_note = (rising_) ? keyboard_.getHigherNote(lastNote_)
-                            : keyboard_.getLowerNote(lastNote_);
-
-  if (IsDummyNote(arp_note)) {
-    // reverse direction if hit boundary
-    if (rising_ && currentOctave_ == octave_ - 1) {
-      rising_ = false;
-      if (repeat_boundary) {
-        return keyboard_.getHighestNote();
-      }
-    } else if (!rising_ && currentOctave_ == 0) {
-      rising_ = true;
-      if (repeat_boundary) {
-        return keyboard_.getLowestNote();
-      }
-    }
-
-    // try again
-    if (rising_) {
-      arp_note = keyboard_.getHigherNote(lastNote_);
-
-      if (IsDummyNote(arp_note)) {
-        arp_note = keyboard_.getLowestNote();
-        currentOctave_ = (currentOctave_ + 1) % octave_;
-      }
-    } else {
-      arp_note = keyboard_.getLowerNote(lastNote_);
-      if (IsDummyNote(arp_note)) {
-        arp_note = keyboard_.getHighestNote();
-        currentOctave_ = positive_modulo(currentOctave_ - 1, octave_);
-      }
-    }
+// MARK: cycle
+Arpeggiator::ArpState Arpeggiator::getFirstArpState() const {
+  switch (type_) {
+    case ArpType::Manual:
+      return {static_cast<std::int16_t>(keyboard_.getEarliestNote()), 0,
+              rising_};
+    case ArpType::Rise:
+      return {static_cast<std::int16_t>(keyboard_.getLowestNote()), 0,
+              rising_};
+    case ArpType::Fall:
+      return {static_cast<std::int16_t>(keyboard_.getHighestNote()),
+              static_cast<std::int8_t>(octave_ - 1), rising_};
+    case ArpType::RiseFall:
+    case ArpType::RiseNFall:
+      return {static_cast<std::int16_t>(keyboard_.getLowestNote()), 0, true};
+    case ArpType::FallRise:
+    case ArpType::FallNRise:
+      return {static_cast<std::int16_t>(keyboard_.getHighestNote()),
+              static_cast<std::int8_t>(octave_ - 1), false};
+    case ArpType::Shuffle:
+    case ArpType::Walk:
+    case ArpType::Random:
+    case ArpType::RandomTwo:
+    case ArpType::RandomThree:
+    case ArpType::Chord:
+    case ArpType::Gacha:
+      break;
   }
-  return arp_note;
+  jassertfalse;  // not a cycling type
+  return {static_cast<std::int16_t>(keyboard_.getLowestNote()), 0, true};
 }
 
-void Arpeggiator::renderStep(int index) {
-  int num_notes_pressed = keyboard_.getNumNotesPressed();
-  jassert(num_notes_pressed >= 1);  // otherwise there is nothing to play
-
-  // euclid (rest)
-  int euclid_index = index % euclidLength_;
-
-  // if (type_ == ArpType::Gacha) {
-  //   euclid_index = index % patternLength_;
-  // }
-
-  if (!euclid_simple(euclidFill_, euclidLength_, euclidRotate_, euclid_index))
-    return;
-
-  int arp_note = DUMMY_NOTE;
-  bool repeat_boundary = false;
+Arpeggiator::ArpState Arpeggiator::getNextArpState(int note,
+                                                   int octave,
+                                                   bool rising) const {
+  int next_note = DUMMY_NOTE;
 
   switch (type_) {
-    // MARK: manual
     case ArpType::Manual:
-      if (index == 0) {
-        arp_note = keyboard_.getEarliestNote();
-        currentOctave_ = 0;
-      } else {
-        arp_note = keyboard_.getNextNote(lastNote_);
-
-        if (IsDummyNote(arp_note)) {
-          arp_note = keyboard_.getEarliestNote();
-          currentOctave_ = (currentOctave_ + 1) % octave_;
-        }
+      next_note = keyboard_.getNextNote(note);
+      if (IsDummyNote(next_note)) {
+        next_note = keyboard_.getEarliestNote();
+        octave = (octave + 1) % octave_;
       }
       break;
 
-    // MARK: classic
     case ArpType::Rise:
-      if (index == 0) {
-        arp_note = keyboard_.getLowestNote();
-        currentOctave_ = 0;
-      } else {
-        arp_note = keyboard_.getHigherNote(lastNote_);
-        if (IsDummyNote(arp_note)) {
-          arp_note = keyboard_.getLowestNote();
-          currentOctave_ = (currentOctave_ + 1) % octave_;
-        }
+      next_note = keyboard_.getHigherNote(note);
+      if (IsDummyNote(next_note)) {
+        next_note = keyboard_.getLowestNote();
+        octave = (octave + 1) % octave_;
       }
       break;
 
     case ArpType::Fall:
-      if (index == 0) {
-        arp_note = keyboard_.getHighestNote();
-        currentOctave_ = octave_ - 1;
-      } else {
-        arp_note = keyboard_.getLowerNote(lastNote_);
-
-        if (IsDummyNote(arp_note)) {
-          arp_note = keyboard_.getHighestNote();
-          currentOctave_ = positive_modulo(currentOctave_ - 1, octave_);
-        }
+      next_note = keyboard_.getLowerNote(note);
+      if (IsDummyNote(next_note)) {
+        next_note = keyboard_.getHighestNote();
+        octave = positive_modulo(octave - 1, octave_);
       }
       break;
 
+    case ArpType::RiseFall:
     case ArpType::RiseNFall:
-      repeat_boundary = true;
-      [[fallthrough]];
+    case ArpType::FallRise:
+    case ArpType::FallNRise: {
+      bool repeat_boundary =
+          type_ == ArpType::RiseNFall || type_ == ArpType::FallNRise;
+
+      next_note = rising ? keyboard_.getHigherNote(note)
+                         : keyboard_.getLowerNote(note);
+      if (!IsDummyNote(next_note)) {
+        break;
+      }
 
-    case ArpType::RiseFall:
-      if (index == 0) {
-        arp_note = keyboard_.getLowestNote();
-        rising_ = true;
-        currentOctave_ = 0;
+      // reverse direction if hit boundary
+      if (rising && octave == octave_ - 1) {
+        rising = false;
+        if (repeat_boundary) {
+          next_note = keyboard_.getHighestNote();
+          break;
+        }
+      } else if (!rising && octave == 0) {
+        rising = true;
+        if (repeat_boundary) {
+          next_note = keyboard_.getLowestNote();
+          break;
+        }
+      }
+
+      // try again
+      if (rising) {
+        next_note = keyboard_.getHigherNote(note);
+        if (IsDummyNote(next_note)) {
+          next_note = keyboard_.getLowestNote();
+          octave = (octave + 1) % octave_;
+        }
       } else {
-        arp_note = getAdjacentArpNote(repeat_boundary);
+        next_note = keyboard_.getLowerNote(note);
+        if (IsDummyNote(next_note)) {
+          next_note = keyboard_.getHighestNote();
+          octave = positive_modulo(octave - 1, octave_);
+        }
       }
       break;
+    }
 
-    case ArpType::FallNRise:
-      repeat_boundary = true;
-      [[fallthrough]];
+    case ArpType::Shuffle:
+    case ArpType::Walk:
+    case ArpType::Random:
+    case ArpType::RandomTwo:
+    case ArpType::RandomThree:
+    case ArpType::Chord:
+    case ArpType::Gacha:
+      jassertfalse;  // not a cycling type
+      break;
+  }
+
+  return {static_cast<std::int16_t>(next_note),
+          static_cast<std::int8_t>(octave), rising};
+}
+
+void Arpeggiator::compileArpCycle(ArpState first) {
+  // where each state was visited, by note, octave and direction
+  std::int16_t visited[ARP_MAX_CYCLE_LENGTH];
+  std::fill(std::begin(visited), std::end(visited), -1);
+  auto key = [](const ArpState& state) {
+    return (state.note * ARP_MAX_OCTAVE + state.octave) * 2 + state.rising;
+  };
+
+  arpCycleLength_ = 0;
+  auto state = first;
+  while (visited[key(state)] < 0) {
+    visited[key(state)] = static_cast<std::int16_t>(arpCycleLength_);
+    arpCycle_[arpCycleLength_++] = state;
+    state = getNextArpState(state.note, state.octave, state.rising);
+  }
+
+  arpCycleLoopStart_ = visited[key(state)];
+  arpCyclePosition_ = 0;
+  arpCycleValid_ = true;
+}
+
+void Arpeggiator::renderStep(int index) {
+  int num_notes_pressed = keyboard_.getNumNotesPressed();
+  jassert(num_notes_pressed >= 1);  // otherwise there is nothing to play
+
+  // euclid or rhythm pattern (rest)
+  if (!getRhythm().isPulse(index))
+    return;
+
+  int arp_note = DUMMY_NOTE;
 
+  switch (type_) {
+    // MARK: manual and classic
+    case ArpType::Manual:
+    case ArpType::Rise:
+    case ArpType::Fall:
+    case ArpType::RiseFall:
+    case ArpType::RiseNFall:
     case ArpType::FallRise:
+    case ArpType::FallNRise: {
       if (index == 0) {
-        arp_note = keyboard_.getHighestNote();
-        rising_ = false;
-        currentOctave_ = octave_ - 1;
-      } else {
-        arp_note = getAdjacentArpNote(repeat_boundary);
+        compileArpCycle(getFirstArpState());
+      } else if (!arpCycleValid_) {
+        // continue from the last note with the new notes, octave or type
+        compileArpCycle(getNextArpState(lastNote_, currentOctave_, rising_));
+      } else if (++arpCyclePosition_ == arpCycleLength_) {
+        arpCyclePosition_ = arpCycleLoopStart_;
       }
+
+      const auto& state = arpCycle_[arpCyclePosition_];
+      arp_note = state.note;
+      currentOctave_ = state.octave;
+      rising_ = state.rising;
       break;
+    }
 
     // MARK: random
     case ArpType::Random:
-      arp_note = keyboard_.getRandomNote();
-      currentOctave_ = juce::Random::getSystemRandom().nextInt(octave_);
-      DBG("index: " << index << " random 1 mode");
+      arp_note = keyboard_.getRandomNote(noteRandom_);
+      currentOctave_ = octaveRandom_.nextInt(octave_);
       break;
 
     case ArpType::Shuffle:
       // re-shuffle on every loop start
-      if (index % (num_notes_pressed * octave_) == 0) {
-        shuffleNotesWithOctave();
+      if (index % numShuffledNotes_ == 0) {
+        drawShuffledNotes(numShuffledNotes_);
         // TODO: reshuffle until shuffled_note_list[0] != last_note_number
       }
-      arp_note = shuffledNoteList_[static_cast<size_t>(
-          index % (num_notes_pressed * octave_))];
+      arp_note = shuffledNotes_[index % numShuffledNotes_];
       break;
 
     case ArpType::Walk:
       if (index == 0) {
-        arp_note = keyboard_.getRandomNote();
-        currentOctave_ = juce::Random::getSystemRandom().nextInt(octave_);
-      } else if (juce::Random::getSystemRandom().nextBool()) {
+        arp_note = keyboard_.getRandomNote(noteRandom_);
+        currentOctave_ = octaveRandom_.nextInt(octave_);
+      } else if (noteRandom_.nextBool()) {
         arp_note = keyboard_.getHigherNote(lastNote_);
         if (IsDummyNote(arp_note)) {
           arp_note = keyboard_.getLowestNote();
@@ -267,11 +308,11 @@ void Arpeggiator::renderStep(int index) {
     case ArpType::RandomThree:
       if (num_notes_pressed > 2 || octave_ > 2 ||
           (num_notes_pressed == 2 && octave_ == 2)) {
-        // re-shuffle on every step
-        shuffleNotesWithOctave();
+        // draw 3 different notes on every step
+        drawShuffledNotes(3);
 
-        for (size_t i = 0; i < 3; ++i) {
-          arp_note = shuffledNoteList_[i];
+        for (int i = 0; i < 3; ++i) {
+          arp_note = shuffledNotes_[i];
           renderArpNote(index, arp_note);
         }
         return;
@@ -283,14 +324,13 @@ void Arpeggiator::renderStep(int index) {
       if (num_notes_pressed == 1 && octave_ == 1) {
         arp_note = keyboard_.getLowestNote();
       } else {
-        // re-shuffle on every step
-        shuffleNotesWithOctave();
+        // draw 2 different notes on every step
+        drawShuffledNotes(2);
 
-        for (size_t i = 0; i < 2; ++i) {
-          arp_note = shuffledNoteList_[i];
+        for (int i = 0; i < 2; ++i) {
+          arp_note = shuffledNotes_[i];
           renderArpNote(index, arp_note);
         }
-        DBG("index: " << index << " random 2/3 mode");
         return;
       }
       break;
@@ -301,11 +341,10 @@ void Arpeggiator::renderStep(int index) {
         currentOctave_ = 0;
       }
 
-      for (int note : shuffledNoteList_) {
-        arp_note = note;
+      for (int i = 0; i < numShuffledNotes_; ++i) {
+        arp_note = shuffledNotes_[i];
         renderArpNote(index, arp_note);
       }
-      DBG("index: " << index << " chord");
       return;
       break;
 
@@ -330,267 +369,39 @@ void Arpeggiator::renderStep(int index) {
   lastNote_ = arp_note;
 
   renderArpNote(index, arp_note);
-  DBG("index: " << index << " note: " << arp_note);
 }
 
 // MARK: euclid
+namespace {
+struct EuclidSettings {
+  int fill;
+  int length;
+  int rotation;
+};
+
+// indexed by EuclidPattern, the rotations keep the rhythms of the former
+// euclid_simple(fill, length, length / fill, i) so that presets sound the same
+// (the first pulse is always on)
+constexpr EuclidSettings EUCLID_PATTERN_SETTINGS[] = {
+    {1, 1, 0}, {15, 16, 2}, {13, 14, 2}, {12, 13, 2}, {11, 12, 2}, {10, 11, 2},
+    {9, 10, 2}, {8, 9, 2}, {7, 8, 2}, {13, 15, 10}, {6, 7, 2}, {11, 13, 9},
+    {5, 6, 2}, {9, 11, 8}, {13, 16, 8}, {4, 5, 2}, {11, 14, 7}, {7, 9, 7},
+    {10, 13, 7}, {3, 4, 2}, {11, 15, 6}, {8, 11, 6}, {5, 7, 6}, {7, 10, 6},
+    {9, 13, 6}, {11, 16, 6}, {9, 14, 5}, {7, 11, 5}, {5, 8, 5}, {8, 13, 0},
+    {3, 5, 0}, {7, 12, 5}, {4, 7, 5}, {9, 16, 5}, {5, 9, 5}, {6, 11, 5},
+    {7, 13, 5}, {8, 15, 5}, {7, 15, 3}, {6, 13, 3}, {5, 11, 3}, {4, 9, 3},
+    {7, 16, 12}, {3, 7, 3}, {5, 12, 10}, {2, 5, 3}, {5, 13, 8}, {3, 8, 0},
+    {4, 11, 8}, {5, 14, 8}, {5, 16, 4}, {4, 13, 4}, {3, 10, 4}, {2, 7, 4},
+    {3, 11, 0}, {4, 15, 11}, {3, 13, 5}, {2, 9, 5}, {3, 14, 0}, {3, 16, 6},
+    {2, 11, 6}, {2, 13, 7}, {2, 15, 8}};
+static_assert(std::size(EUCLID_PATTERN_SETTINGS) ==
+              static_cast<std::size_t>(Arpeggiator::EuclidPattern::_2_15) + 1);
+}  // namespace
+
 void Arpeggiator::setEuclidPattern(EuclidPattern pattern) {
-  switch (pattern) {
-    case EuclidPattern::Off:
-      euclidFill_ = 1;
-      euclidLength_ = 1;
-      break;
-    case EuclidPattern::_15_16:
-      euclidFill_ = 15;
-      euclidLength_ = 16;
-      break;
-    case EuclidPattern::_13_14:
-      euclidFill_ = 13;
-      euclidLength_ = 14;
-      break;
-    case EuclidPattern::_12_13:
-      euclidFill_ = 12;
-      euclidLength_ = 13;
-      break;
-    case EuclidPattern::_11_12:
-      euclidFill_ = 11;
-      euclidLength_ = 12;
-      break;
-    case EuclidPattern::_10_11:
-      euclidFill_ = 10;
-      euclidLength_ = 11;
-      break;
-    case EuclidPattern::_9_10:
-      euclidFill_ = 9;
-      euclidLength_ = 10;
-      break;
-    case EuclidPattern::_8_9:
-      euclidFill_ = 8;
-      euclidLength_ = 9;
-      break;
-    case EuclidPattern::_7_8:
-      euclidFill_ = 7;
-      euclidLength_ = 8;
-      break;
-    case EuclidPattern::_13_15:
-      euclidFill_ = 13;
-      euclidLength_ = 15;
-      break;
-    case EuclidPattern::_6_7:
-      euclidFill_ = 6;
-      euclidLength_ = 7;
-      break;
-    case EuclidPattern::_11_13:
-      euclidFill_ = 11;
-      euclidLength_ = 13;
-      break;
-    case EuclidPattern::_5_6:
-      euclidFill_ = 5;
-      euclidLength_ = 6;
-      break;
-    case EuclidPattern::_9_11:
-      euclidFill_ = 9;
-      euclidLength_ = 11;
-      break;
-    case EuclidPattern::_13_16:
-      euclidFill_ = 13;
-      euclidLength_ = 16;
-      break;
-    case EuclidPattern::_4_5:
-      euclidFill_ = 4;
-      euclidLength_ = 5;
-      break;
-    case EuclidPattern::_11_14:
-      euclidFill_ = 11;
-      euclidLength_ = 14;
-      break;
-    case EuclidPattern::_7_9:
-      euclidFill_ = 7;
-      euclidLength_ = 9;
-      break;
-    case EuclidPattern::_10_13:
-      euclidFill_ = 10;
-      euclidLength_ = 13;
-      break;
-    case EuclidPattern::_3_4:
-      euclidFill_ = 3;
-      euclidLength_ = 4;
-      break;
-    case EuclidPattern::_11_15:
-      euclidFill_ = 11;
-      euclidLength_ = 15;
-      break;
-    case EuclidPattern::_8_11:
-      euclidFill_ = 8;
-      euclidLength_ = 11;
-      break;
-    case EuclidPattern::_5_7:
-      euclidFill_ = 5;
-      euclidLength_ = 7;
-      break;
-    case EuclidPattern::_7_10:
-      euclidFill_ = 7;
-      euclidLength_ = 10;
-      break;
-    case EuclidPattern::_9_13:
-      euclidFill_ = 9;
-      euclidLength_ = 13;
-      break;
-    case EuclidPattern::_11_16:
-      euclidFill_ = 11;
-      euclidLength_ = 16;
-      break;
-    case EuclidPattern::_9_14:
-      euclidFill_ = 9;
-      euclidLength_ = 14;
-      break;
-    case EuclidPattern::_7_11:
-      euclidFill_ = 7;
-      euclidLength_ = 11;
-      break;
-    case EuclidPattern::_5_8:
-      euclidFill_ = 5;
-      euclidLength_ = 8;
-      break;
-    case EuclidPattern::_8_13:
-      euclidFill_ = 8;
-      euclidLength_ = 13;
-      break;
-    case EuclidPattern::_3_5:
-      euclidFill_ = 3;
-      euclidLength_ = 5;
-      break;
-    case EuclidPattern::_7_12:
-      euclidFill_ = 7;
-      euclidLength_ = 12;
-      break;
-    case EuclidPattern::_4_7:
-      euclidFill_ = 4;
-      euclidLength_ = 7;
-      break;
-    case EuclidPattern::_9_16:
-      euclidFill_ = 9;
-      euclidLength_ = 16;
-      break;
-    case EuclidPattern::_5_9:
-      euclidFill_ = 5;
-      euclidLength_ = 9;
-      break;
-    case EuclidPattern::_6_11:
-      euclidFill_ = 6;
-      euclidLength_ = 11;
-      break;
-    case EuclidPattern::_7_13:
-      euclidFill_ = 7;
-      euclidLength_ = 13;
-      break;
-    case EuclidPattern::_8_15:
-      euclidFill_ = 8;
-      euclidLength_ = 15;
-      break;
-    case EuclidPattern::_7_15:
-      euclidFill_ = 7;
-      euclidLength_ = 15;
-      break;
-    case EuclidPattern::_6_13:
-      euclidFill_ = 6;
-      euclidLength_ = 13;
-      break;
-    case EuclidPattern::_5_11:
-      euclidFill_ = 5;
-      euclidLength_ = 11;
-      break;
-    case EuclidPattern::_4_9:
-      euclidFill_ = 4;
-      euclidLength_ = 9;
-      break;
-    case EuclidPattern::_7_16:
-      euclidFill_ = 7;
-      euclidLength_ = 16;
-      break;
-    case EuclidPattern::_3_7:
-      euclidFill_ = 3;
-      euclidLength_ = 7;
-      break;
-    case EuclidPattern::_5_12:
-      euclidFill_ = 5;
-      euclidLength_ = 12;
-      break;
-    case EuclidPattern::_2_5:
-      euclidFill_ = 2;
-      euclidLength_ = 5;
-      break;
-    case EuclidPattern::_5_13:
-      euclidFill_ = 5;
-      euclidLength_ = 13;
-      break;
-    case EuclidPattern::_3_8:
-      euclidFill_ = 3;
-      euclidLength_ = 8;
-      break;
-    case EuclidPattern::_4_11:
-      euclidFill_ = 4;
-      euclidLength_ = 11;
-      break;
-    case EuclidPattern::_5_14:
-      euclidFill_ = 5;
-      euclidLength_ = 14;
-      break;
-    case EuclidPattern::_5_16:
-      euclidFill_ = 5;
-      euclidLength_ = 16;
-      break;
-    case EuclidPattern::_4_13:
-      euclidFill_ = 4;
-      euclidLength_ = 13;
-      break;
-    case EuclidPattern::_3_10:
-      euclidFill_ = 3;
-      euclidLength_ = 10;
-      break;
-    case EuclidPattern::_2_7:
-      euclidFill_ = 2;
-      euclidLength_ = 7;
-      break;
-    case EuclidPattern::_3_11:
-      euclidFill_ = 3;
-      euclidLength_ = 11;
-      break;
-    case EuclidPattern::_4_15:
-      euclidFill_ = 4;
-      euclidLength_ = 15;
-      break;
-    case EuclidPattern::_3_13:
-      euclidFill_ = 3;
-      euclidLength_ = 13;
-      break;
-    case EuclidPattern::_2_9:
-      euclidFill_ = 2;
-      euclidLength_ = 9;
-      break;
-    case EuclidPattern::_3_14:
-      euclidFill_ = 3;
-      euclidLength_ = 14;
-      break;
-    case EuclidPattern::_3_16:
-      euclidFill_ = 3;
-      euclidLength_ = 16;
-      break;
-    case EuclidPattern::_2_11:
-      euclidFill_ = 2;
-      euclidLength_ = 11;
-      break;
-    case EuclidPattern::_2_13:
-      euclidFill_ = 2;
-      euclidLength_ = 13;
-      break;
-    case EuclidPattern::_2_15:
-      euclidFill_ = 2;
-      euclidLength_ = 15;
-      break;
-  }
-  // this line guarantees that first pulse is always on
-  euclidRotate_ = euclidLength_ / euclidFill_;
+  const auto& settings =
+      EUCLID_PATTERN_SETTINGS[static_cast<std::size_t>(pattern)];
+  setEuclid(settings.fill, settings.length, settings.rotation);
 }
 
 }  // namespace Sequencer
\ No newline at end of file
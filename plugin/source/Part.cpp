@@ -16,60 +16,88 @@ void Part::renderNote(int index, Note note) {
   // clip note length to seq length
   note.length = std::min(note.length, static_cast<float>(trackLength_));
 
-  int note_on_tick =
-      static_cast<int>((index + note.offset) * getTicksPerStep());
-  int note_off_tick =
-      static_cast<int>((index + note.offset + note.length) * getTicksPerStep());
+  // keep the fraction of a tick, so that recorded timing survives
+  auto note_on = GetTickPosition(static_cast<float>(index) + note.offset,
+                                 getTicksPerStep());
+  auto note_off = GetTickPosition(
+      static_cast<float>(index) + note.offset + note.length, getTicksPerStep());
 
   // force note off before the next note on of the same note
-  // search all midi messages after note_on_tick
+  // all queued events are due at or after the current tick
   // if there is a note off with the same note number
   // delete that and insert a new note off at note_on_tick
-  bool note_off_deleted = false;
-  for (int i = midiQueue_.getNextIndexAtTime(tick_);
-       i < midiQueue_.getNumEvents(); ++i) {
-    auto message = midiQueue_.getEventPointer(i)->message;
-    if (message.isNoteOff() && message.getNoteNumber() == note.number) {
-      midiQueue_.deleteEvent(i, false);
-      note_off_deleted = true;
-    }
-  }
-
-  if (note_off_deleted) {
-    juce::MidiMessage early_note_off_message = juce::MidiMessage::noteOff(
-        getChannel(), note.number, static_cast<juce::uint8>(note.velocity));
-    early_note_off_message.setTimeStamp(note_on_tick);  // -1?
-    renderMidiMessage(early_note_off_message);
+  if (notesWithNoteOff_.contains(note.number)) {
+    midiQueue_.remove(noteOffs_[note.number]);
+    notesWithNoteOff_.erase(note.number);
+    renderMidiEvent(MidiEvent::noteOff(note_on.tick, getChannel(), note.number,
+                                       note.velocity),
+                    note_on.fraction);  // -1?
   }
 
   // note on
-  juce::MidiMessage note_on_message = juce::MidiMessage::noteOn(
-      getChannel(), note.number, static_cast<juce::uint8>(note.velocity));
-  note_on_message.setTimeStamp(note_on_tick);
-  renderMidiMessage(note_on_message);
+  renderMidiEvent(MidiEvent::noteOn(note_on.tick, getChannel(), note.number,
+                                    note.velocity),
+                  note_on.fraction);
 
   // note off
-  juce::MidiMessage note_off_message = juce::MidiMessage::noteOff(
-      getChannel(), note.number, static_cast<juce::uint8>(note.velocity));
-  note_off_message.setTimeStamp(note_off_tick);
-  renderMidiMessage(note_off_message);
+  EventHandle handle = 0;
+  if (renderMidiEvent(MidiEvent::noteOff(note_off.tick, getChannel(),
+                                         note.number, note.velocity),
+                      note_off.fraction, &handle)) {
+    noteOffs_[note.number] = handle;
+    notesWithNoteOff_.insert(note.number);
+  }
 }
 
-// insert a future MIDI message into MIDI queue
-void Part::renderMidiMessage(juce::MidiMessage message) {
-  // int tick = static_cast<int>(message.getTimeStamp());
-  // tick = ApplySwingToTick(tick);
-  // message.setTimeStamp(static_cast<int>(tick));
-  midiQueue_.addEvent(message);
+// insert a future MIDI event into MIDI queue
+bool Part::renderMidiEvent(MidiEvent event,
+                           float subTick,
+                           EventHandle* handle) {
+  // event.tick = ApplySwingToTick(event.tick);
+  event.tick += loopOrigin_;
+  event.subTick = subTick;
+  if (!midiQueue_.push(event, handle)) {
+    jassertfalse;  // MIDI queue full, event dropped
+    return false;
+  }
+  return true;
+}
+
+void Part::sendMidiEvent(MidiEvent event) {
+  sendMidiMessage(
+      juce::MidiMessage(event.status, event.data1, event.data2,
+                        static_cast<double>(event.tick) +
+                            static_cast<double>(event.subTick)));
 }
 
 void Part::reset(float start_index) {
   sendNoteOffNow();
-  midiQueue_.clear();
-  tick_ = static_cast<int>(getTicksPerStep() * start_index);
+  clearMidiQueue();
+  moveTo(static_cast<int>(
+      std::lround(static_cast<float>(getTicksPerStep()) * start_index)));
   resolution_ = resolutionNew_;  // necessary?
 }
 
+int Part::getTickAtSongPosition(juce::int64 songTick) const {
+  // loop spans [-0.5, length-0.5) steps
+  auto loop_ticks = static_cast<juce::int64>(trackLengthNew_) *
+                    RESOLUTION_TICKS_TABLE[static_cast<int>(resolutionNew_)];
+  auto half_step = RESOLUTION_TICKS_TABLE[static_cast<int>(resolutionNew_)] / 2;
+  auto position = (songTick + half_step) % loop_ticks;
+  if (position < 0) {
+    position += loop_ticks;
+  }
+  return static_cast<int>(position) - half_step;
+}
+
+void Part::locate(juce::int64 songTick) {
+  sendNoteOffNow();
+  clearMidiQueue();
+  moveTo(getTickAtSongPosition(songTick));
+  trackLength_ = trackLengthNew_;
+  resolution_ = resolutionNew_;
+}
+
 void Part::sendNoteOffNow() {
   // delete unsent note on-offs pairs in the future first?
   // for (int i = midiQueue_.getNextIndexAtTime(tick_);
@@ -81,13 +109,12 @@ void Part::sendNoteOffNow() {
   //   }
   // }
 
-  for (int i = midiQueue_.getNextIndexAtTime(tick_);
-       i < midiQueue_.getNumEvents(); ++i) {
-    auto message = midiQueue_.getEventPointer(i)->message;
-    if (message.isNoteOff()) {
-      message.setTimeStamp(tick_);  // this appears to have no effect though
-      sendMidiMessage(message);
-    }
+  for (int note = notesWithNoteOff_.lowest(); note != NoteSet::NONE;
+       note = notesWithNoteOff_.higherThan(note)) {
+    auto event = midiQueue_.get(noteOffs_[note]);
+    event.tick = getAbsoluteTick();  // this appears to have no effect though
+    event.subTick = 0.f;
+    sendMidiEvent(event);
   }
 }
 
@@ -110,24 +137,61 @@ void Part::tick() {
   }
 
   // send current tick's MIDI events
-  for (int i = midiQueue_.getNextIndexAtTime(tick_);
-       i < midiQueue_.getNextIndexAtTime(tick_ + 1); ++i) {
-    auto message = midiQueue_.getEventPointer(i)->message;
+  MidiEvent event{};
+  EventHandle handle = 0;
+  while (midiQueue_.popDue(getAbsoluteTick(), event, &handle)) {
+    int note = event.getNoteNumber();
+    if (event.isNoteOff() && notesWithNoteOff_.contains(note) &&
+        noteOffs_[note] == handle) {
+      notesWithNoteOff_.erase(note);
+    }
 
     // Note: the following code is necessary for seq but do not make sense for
     // arp, which indicate that MIDI merging should be processed by a separate
     // module (probably VoiceAssigner)
 
     // do not note off if held by the keyboard
-    // if (message.isNoteOff() &&
-    // keyboardRef.isKeyDown(message.getNoteNumber())) {
+    // if (event.isNoteOff() &&
+    // keyboardRef.isKeyDown(event.getNoteNumber())) {
     //   continue;
     // }
 
-    sendMidiMessage(message);
+    sendMidiEvent(event);
   }
 
-  tick_ += 1;
+  moveForward(1);
+}
+
+int Part::getTicksToNextEvent() const {
+  int ticks_per_step = getTicksPerStep();
+  auto ticks_until = [ticks_per_step, this](int phase) {
+    return ((phase - tick_) % ticks_per_step + ticks_per_step) %
+           ticks_per_step;
+  };
+
+  int ticks = std::min(ticks_until(0), ticks_until(getTicksHalfStep()));
+
+  if (!muted_) {
+    int render_tick = getStepRenderTick(getCurrentStepIndex());
+    if (render_tick >= tick_) {
+      ticks = std::min(ticks, render_tick - tick_);
+    }
+  }
+
+  if (!midiQueue_.empty()) {
+    auto due = midiQueue_.top().tick - getAbsoluteTick();
+    ticks = static_cast<int>(std::clamp<juce::int64>(due, 0, ticks));
+  }
+  return ticks;
+}
+
+void Part::skip(int ticks) {
+  jassert(ticks <= getTicksToNextEvent());
+  moveForward(ticks);
+}
+
+void Part::moveForward(int ticks) {
+  tick_ += ticks;
 
   // update track length on step boundaries
   if (tick_ % getTicksPerStep() == getTicksHalfStep()) {
@@ -144,24 +208,11 @@ void Part::tick() {
   // wrap from (length-0.5) to -0.5 step
   // worry: use == instead of >=?
   if (tick_ >= trackLength_ * getTicksPerStep() - getTicksHalfStep()) {
-    midiQueue_.addTimeToMessages(
-        -tick_);  // or use - (trackLength_ * getTicksPerStep() -
-                  // getTicksHalfStep())?
-
-    // only keep newer note events
-    for (const auto& midiEvent : midiQueue_) {
-      if (midiEvent->message.getTimeStamp() >= 0) {
-        midiQueueNext_.addEvent(midiEvent->message);
-      }
-    }
-    midiQueue_.swapWith(midiQueueNext_);
-    midiQueueNext_.clear();
-
     // apply new resulution
     resolution_ = resolutionNew_;
 
-    // tick_ -= trackLength_ * getTicksPerStep();
-    tick_ = -getTicksHalfStep();
+    // notes still ringing keep their place on the absolute timeline
+    moveTo(-getTicksHalfStep());
   }
 }
 }  // namespace Sequencer
\ No newline at end of file
@@ -21,7 +21,7 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor(
   playButton.addShortcut(juce::KeyPress(juce::KeyPress::spaceKey));
   playButton.setTooltip("toggle play and pause (space)");
   playButton.onClick = [this] {
-    processorRef.arpseq.setSequencerPlay(playButton.getToggleState());
+    sendCommand(Command::SequencerPlay, playButton.getToggleState());
   };
   addAndMakeVisible(playButton);
 
@@ -32,7 +32,7 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor(
   restButton.addShortcut(juce::KeyPress('t'));
   // restButton.setTooltip("stop playback and move to start position (s)");
   restButton.onClick = [this] {
-    processorRef.arpseq.setSequencerRest(restButton.getToggleState());
+    sendCommand(Command::SequencerRest, restButton.getToggleState());
     // processorRef.arpseq.startSequencer(true);
     // processorRef.arpseq.stopSequencer();
     // playButton.setToggleState(false,
@@ -48,7 +48,7 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor(
                          juce::Colours::orangered);
   recordButton.onClick = [this] {
     const bool should_be_recording = recordButton.getToggleState();
-    processorRef.arpseq.setSequencerArmed(should_be_recording);
+    sendCommand(Command::SequencerArmed, should_be_recording);
     if (should_be_recording) {
       keytriggerButton.setToggleState(false,
                                       juce::NotificationType::sendNotification);
@@ -64,7 +64,7 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor(
   quantizeButton.setColour(juce::TextButton::ColourIds::buttonOnColourId,
                            juce::Colours::orangered);
   quantizeButton.onClick = [this] {
-    processorRef.arpseq.setQuantizeRec(quantizeButton.getToggleState());
+    sendCommand(Command::QuantizeRec, quantizeButton.getToggleState());
   };
   addAndMakeVisible(quantizeButton);
 
@@ -77,7 +77,7 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor(
 
   keytriggerButton.onClick = [this] {
     bool should_keytrigger = keytriggerButton.getToggleState();
-    processorRef.arpseq.setKeyTrigger(should_keytrigger);
+    sendCommand(Command::KeyTrigger, should_keytrigger);
     if (should_keytrigger) {
       recordButton.setToggleState(false, juce::sendNotification);
       // playButton.setToggleState(false, juce::sendNotification);
@@ -89,9 +89,8 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor(
   keytriggerModeSelector.addItemList(
       {"Retrigger (Mono)", "Transpose (Mono Legato)", "First Key (Poly)"}, 1);
   keytriggerModeSelector.onChange = [this] {
-    processorRef.arpseq.setKeytriggerMode(
-        static_cast<Sequencer::ArpSeq::KeytriggerMode>(
-            keytriggerModeSelector.getSelectedId() - 1));
+    sendCommand(Command::KeytriggerMode,
+                keytriggerModeSelector.getSelectedId() - 1);
   };
   addAndMakeVisible(keytriggerModeSelector);
   keytriggerModeSelector.setSelectedId(
@@ -103,9 +102,8 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor(
   arpVelocityModeSelector.addItemList(
       {"As Played", "Average", "Last Note", "Fixed"}, 1);
   arpVelocityModeSelector.onChange = [this] {
-    processorRef.arpseq.getArp().setVelocityMode(
-        static_cast<Sequencer::Arpeggiator::VelocityMode>(
-            arpVelocityModeSelector.getSelectedId() - 1));
+    sendCommand(Command::ArpVelocityMode,
+                arpVelocityModeSelector.getSelectedId() - 1);
   };
   addAndMakeVisible(arpVelocityModeSelector);
   arpVelocityModeSelector.setSelectedId(
@@ -120,7 +118,7 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor(
   holdButton.setColour(juce::TextButton::ColourIds::buttonOnColourId,
                        juce::Colours::orangered);
   holdButton.onClick = [this]() {
-    processorRef.arpseq.setHold(holdButton.getToggleState());
+    sendCommand(Command::Hold, holdButton.getToggleState());
   };
   addAndMakeVisible(holdButton);
 
@@ -131,7 +129,7 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor(
   arpButton.setColour(juce::TextButton::ColourIds::buttonOnColourId,
                       juce::Colours::orangered);
   arpButton.onClick = [this] {
-    processorRef.arpseq.setArp(arpButton.getToggleState());
+    sendCommand(Command::Arp, arpButton.getToggleState());
   };
   addAndMakeVisible(arpButton);
 
@@ -240,7 +238,7 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor(
     bpmSlider.setValue(BPM_DEFAULT);
     bpmSlider.setDoubleClickReturnValue(true, BPM_DEFAULT);
     bpmSlider.onValueChange = [this] {
-      processorRef.arpseq.setBpm(bpmSlider.getValue());
+      sendCommand(Command::Bpm, bpmSlider.getValue());
     };
     addAndMakeVisible(bpmSlider);
   }
@@ -254,7 +252,7 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor(
   swingSlider.setValue(0.0);
   swingSlider.setDoubleClickReturnValue(true, 0.0);
   swingSlider.onValueChange = [this] {
-    processorRef.arpseq.setSwing(swingSlider.getValue());
+    sendCommand(Command::Swing, swingSlider.getValue());
   };
   addAndMakeVisible(swingSlider);
 
@@ -267,8 +265,7 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor(
   polyphonySlider.setRange(1, 10, 1);
   polyphonySlider.setValue(10);
   polyphonySlider.onValueChange = [this] {
-    processorRef.arpseq.getVoiceLimiter().setNumVoices(
-        static_cast<size_t>(polyphonySlider.getValue()));
+    sendCommand(Command::NumVoices, polyphonySlider.getValue());
   };
   addAndMakeVisible(polyphonySlider);
 
@@ -279,7 +276,31 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor(
   addAndMakeVisible(onScreenKeyboard);
 }
 
-AudioPluginAudioProcessorEditor::~AudioPluginAudioProcessorEditor() {}
+AudioPluginAudioProcessorEditor::~AudioPluginAudioProcessorEditor() {
+  stopTimer();
+}
+
+void AudioPluginAudioProcessorEditor::sendCommand(Command command,
+                                                  double value) {
+  // keep the order: nothing overtakes a command still waiting
+  if (unsentCommands.empty() &&
+      processorRef.arpseq.sendCommand(command, value)) {
+    return;
+  }
+  unsentCommands.emplace_back(command, value);
+  startTimer(10);
+}
+
+void AudioPluginAudioProcessorEditor::timerCallback() {
+  auto sent = std::find_if_not(
+      unsentCommands.begin(), unsentCommands.end(), [this](const auto& c) {
+        return processorRef.arpseq.sendCommand(c.first, c.second);
+      });
+  unsentCommands.erase(unsentCommands.begin(), sent);
+  if (unsentCommands.empty()) {
+    stopTimer();
+  }
+}
 
 void AudioPluginAudioProcessorEditor::paint(juce::Graphics& g) {
   // (Our component is opaque, so we must completely fill the background with a
@@ -1,9 +1,6 @@
 #include "PolyArp/PluginProcessor.h"
 #include "PolyArp/PluginEditor.h"
 
-#define HIRES_TIMER_INTERVAL_MS 1
-#define E3_PPQ (TICKS_PER_16TH * 4)
-
 namespace audio_plugin {
 AudioPluginAudioProcessor::AudioPluginAudioProcessor()
     : AudioProcessor(
@@ -15,9 +12,7 @@ AudioPluginAudioProcessor::AudioPluginAudioProcessor()
               .withOutput("Output", juce::AudioChannelSet::stereo(), true)
 #endif
               ),
-      arpseq(arpMidiCollector),
-      parameters(*this, &undoManager, "PolyArp", createParameterLayout()),
-      lastCallbackTime(0.0) {
+      parameters(*this, &undoManager, "PolyArp", createParameterLayout()) {
   // arp parameters
   arpTypeParam = parameters.getRawParameterValue("ARP_TYPE");
   arpOctaveParam = parameters.getRawParameterValue("ARP_OCTAVE");
@@ -26,55 +21,31 @@ AudioPluginAudioProcessor::AudioPluginAudioProcessor()
   arpTransposeParam = parameters.getRawParameterValue("ARP_TRANSPOSE");
   euclidPatternParam = parameters.getRawParameterValue("EUCLID_PATTERN");
   euclidLegatoParam = parameters.getRawParameterValue("EUCLID_LEGATO");
+  rhythmPatternParam = parameters.getRawParameterValue("RHYTHM_PATTERN");
+
+  // a new instance gets its own seed, a restored one replays the saved seed
+  setRandomSeed(juce::Random::getSystemRandom().nextInt64());
 
   // seq parameters
   seqLengthParam = parameters.getRawParameterValue("SEQ_LENGTH");
-  for (int step = 0; step < STEP_SEQ_MAX_LENGTH; ++step) {
-    juce::String prefix = "S" + juce::String(step) + "_";
-    seqStepEnabledParam[step] =
-        parameters.getRawParameterValue(prefix + "ENABLED");
-
-    for (int note = 0; note < POLYPHONY; ++note) {
-      juce::String note_signifier = "N" + juce::String(note) + "_";
-
-      seqStepNoteParam[step][note] =
-          parameters.getRawParameterValue(prefix + note_signifier + "NOTE");
-      seqStepVelocityParam[step][note] =
-          parameters.getRawParameterValue(prefix + note_signifier + "VELOCITY");
-      seqStepOffsetParam[step][note] =
-          parameters.getRawParameterValue(prefix + note_signifier + "OFFSET");
-      seqStepLengthParam[step][note] =
-          parameters.getRawParameterValue(prefix + note_signifier + "LENGTH");
-    }
+  for (int index = 0; index < NUM_STEP_PARAMETERS; ++index) {
+    auto id = STEP_PARAMETER_IDS[static_cast<std::size_t>(index)].text;
+    stepParams[index] = parameters.getParameter(id);
+    stepParamValues[index] = parameters.getRawParameterValue(id);
   }
 
-  arpseq.notifyProcessorSeqUpdate =
-      [this](int step_index, Sequencer::PolyStep<POLYPHONY> step) {
-        undoManager.beginNewTransaction("Live recording note");
-
-        juce::String prefix = "S" + juce::String(step_index) + "_";
-        auto p = parameters.getParameter(prefix + "ENABLED");
-        p->setValueNotifyingHost(static_cast<float>(step.enabled));
-
-        for (int i = 0; i < POLYPHONY; ++i) {
-          auto note_signifier = "N" + juce::String(i) + "_";
-          p = parameters.getParameter(prefix + note_signifier + "NOTE");
-          p->setValueNotifyingHost(
-              p->convertTo0to1(static_cast<float>(step.notes[i].number)));
-
-          p = parameters.getParameter(prefix + note_signifier + "VELOCITY");
-          p->setValueNotifyingHost(
-              p->convertTo0to1(static_cast<float>(step.notes[i].velocity)));
-
-          p = parameters.getParameter(prefix + note_signifier + "OFFSET");
-          p->setValueNotifyingHost(p->convertTo0to1(step.notes[i].offset));
-
-          p = parameters.getParameter(prefix + note_signifier + "LENGTH");
-          p->setValueNotifyingHost(p->convertTo0to1(step.notes[i].length));
-        }
-      };
+  for (int step = 0; step < STEP_SEQ_MAX_LENGTH; ++step) {
+    stepListeners[step].dirtySteps = &dirtySteps;
+    stepListeners[step].publishingSteps = &publishingSteps;
+    stepListeners[step].step = step;
+  }
+  for (int index = 0; index < NUM_STEP_PARAMETERS; ++index) {
+    parameters.addParameterListener(
+        STEP_PARAMETER_IDS[static_cast<std::size_t>(index)].text,
+        &stepListeners[GetStepOfParameter(index)]);
+  }
 
-  HighResolutionTimer::startTimer(HIRES_TIMER_INTERVAL_MS);
+  startTimerHz(30);
 }
 
 const juce::String OffsetText[] = {
@@ -152,48 +123,41 @@ AudioPluginAudioProcessor::createParameterLayout() {
   layout.add(std::make_unique<AudioParameterBool>("EUCLID_LEGATO",
                                                   "Euclid Legato", false));
 
+  // Yarns rhythm patterns, replace the euclid pattern unless off
+  StringArray rhythmPatternChoices{"Off"};
+  for (int pattern = 1; pattern <= YARNS_NUM_PATTERNS; ++pattern) {
+    rhythmPatternChoices.add(String(pattern));
+  }
+
+  layout.add(std::make_unique<AudioParameterChoice>(
+      "RHYTHM_PATTERN", "Rhythm Pattern", rhythmPatternChoices, 0));
+
   layout.add(std::make_unique<AudioParameterInt>(
       "SEQ_LENGTH", "Sequencer Length", STEP_SEQ_MIN_LENGTH,
       STEP_SEQ_MAX_LENGTH, STEP_SEQ_DEFAULT_LENGTH));
 
+  // same order as the step parameter indices
   for (int step = 0; step < STEP_SEQ_MAX_LENGTH; ++step) {
-    String prefix = "S" + String(step) + "_";
-    layout.add(std::make_unique<AudioParameterBool>(prefix + "ENABLED",
-                                                    "Enabled", false));
-
-    layout.add(std::make_unique<AudioParameterInt>(
-        prefix + "N0_NOTE", "Note", 20, 127, DEFAULT_NOTE, note_attributes));
+    layout.add(std::make_unique<AudioParameterBool>(
+        GetStepParameterID(step, StepField::Enabled), "Enabled", false));
 
-    layout.add(std::make_unique<AudioParameterInt>(
-        prefix + "N0_VELOCITY", "Velocity", 1, 127, DEFAULT_VELOCITY));
-
-    layout.add(std::make_unique<AudioParameterFloat>(
-        prefix + "N0_OFFSET", "Offset",
-        NormalisableRange<float>(-0.5f, 0.49f, 0.01f), 0.0f,
-        offset_attributes));
-
-    layout.add(std::make_unique<AudioParameterFloat>(
-        prefix + "N0_LENGTH", "Length",
-        NormalisableRange<float>(0.08f, STEP_SEQ_MAX_LENGTH, 0.01f, 0.5f),
-        static_cast<float>(DEFAULT_LENGTH)));
-
-    for (int note = 1; note < POLYPHONY; ++note) {
-      String note_signifier = "N" + String(note) + "_";
+    for (int note = 0; note < POLYPHONY; ++note) {
+      // only the first note of a step is on by default
       layout.add(std::make_unique<AudioParameterInt>(
-          prefix + note_signifier + "NOTE", "Note", 20, 127, DISABLED_NOTE,
-          note_attributes));
+          GetStepParameterID(step, StepField::Note, note), "Note", 20, 127,
+          note == 0 ? DEFAULT_NOTE : DISABLED_NOTE, note_attributes));
 
       layout.add(std::make_unique<AudioParameterInt>(
-          prefix + note_signifier + "VELOCITY", "Velocity", 1, 127,
-          DEFAULT_VELOCITY));
+          GetStepParameterID(step, StepField::Velocity, note), "Velocity", 1,
+          127, DEFAULT_VELOCITY));
 
       layout.add(std::make_unique<AudioParameterFloat>(
-          prefix + note_signifier + "OFFSET", "Offset",
+          GetStepParameterID(step, StepField::Offset, note), "Offset",
           NormalisableRange<float>(-0.5f, 0.49f, 0.01f), 0.0f,
           offset_attributes));
 
       layout.add(std::make_unique<AudioParameterFloat>(
-          prefix + note_signifier + "LENGTH", "Length",
+          GetStepParameterID(step, StepField::Length, note), "Length",
           NormalisableRange<float>(0.08f, STEP_SEQ_MAX_LENGTH, 0.01f, 0.5f),
           static_cast<float>(DEFAULT_LENGTH)));
     }
@@ -203,7 +167,12 @@ AudioPluginAudioProcessor::createParameterLayout() {
 }
 
 AudioPluginAudioProcessor::~AudioPluginAudioProcessor() {
-  HighResolutionTimer::stopTimer();
+  stopTimer();
+  for (int index = 0; index < NUM_STEP_PARAMETERS; ++index) {
+    parameters.removeParameterListener(
+        STEP_PARAMETER_IDS[static_cast<std::size_t>(index)].text,
+        &stepListeners[GetStepOfParameter(index)]);
+  }
 }
 
 const juce::String AudioPluginAudioProcessor::getName() const {
@@ -266,9 +235,15 @@ void AudioPluginAudioProcessor::prepareToPlay(double sampleRate,
                                               int samplesPerBlock) {
   // Use this method as the place to do any pre-playback
   // initialisation that you need..
-  juce::ignoreUnused(sampleRate, samplesPerBlock);
+  arpseq.prepareToPlay(sampleRate, samplesPerBlock);
 
-  arpMidiCollector.reset(sampleRate);
+  // lock to the DAW timeline when running as a plugin
+  if (this->wrapperType ==
+      juce::AudioProcessor::WrapperType::wrapperType_VST3) {
+    arpseq.setClockSource(Sequencer::ArpSeq::ClockSource::Host);
+  } else {
+    arpseq.setClockSource(Sequencer::ArpSeq::ClockSource::Internal);
+  }
 }
 
 void AudioPluginAudioProcessor::releaseResources() {
@@ -300,26 +275,21 @@ bool AudioPluginAudioProcessor::isBusesLayoutSupported(
 #endif
 }
 
-void AudioPluginAudioProcessor::hiResTimerCallback() {
-  // MARK: arpseq logic
-  constexpr double deltaTime = HIRES_TIMER_INTERVAL_MS / 1000.0;
-
+void AudioPluginAudioProcessor::applyParameters() {
   // apply parameter
   int length = static_cast<int>(seqLengthParam->load());
   arpseq.getSeq().setLength(length);
   arpseq.getArp().setPatternLength(length);
-  for (int i = 0; i < STEP_SEQ_MAX_LENGTH; ++i) {
-    auto step = arpseq.getSeq().getStepAtIndex(i);
-    step.enabled = static_cast<bool>(seqStepEnabledParam[i]->load());
-
-    for (int j = 0; j < POLYPHONY; ++j) {
-      step.notes[j].number = static_cast<int>(seqStepNoteParam[i][j]->load());
-      step.notes[j].velocity =
-          static_cast<int>(seqStepVelocityParam[i][j]->load());
-      step.notes[j].offset = seqStepOffsetParam[i][j]->load();
-      step.notes[j].length = seqStepLengthParam[i][j]->load();
-    }
-    arpseq.getSeq().setStepAtIndex(i, step);
+
+  // a whole new pattern first, then the steps changed since the last block
+  if (patternSnapshots.update()) {
+    arpseq.setSequencerPattern(patternSnapshots.read());
+  }
+
+  auto dirty_steps = dirtySteps.exchange(0, std::memory_order_acquire);
+  for (; dirty_steps != 0; dirty_steps &= dirty_steps - 1) {
+    int i = std::countr_zero(dirty_steps);
+    arpseq.setSequencerStep(i, readStepParameters(i));
   }
 
   auto arp_type =
@@ -333,6 +303,8 @@ void AudioPluginAudioProcessor::hiResTimerCallback() {
   bool euclid_legato = static_cast<bool>(euclidLegatoParam->load());
   auto euclid_pattern = static_cast<Sequencer::Arpeggiator::EuclidPattern>(
       euclidPatternParam->load());
+  int rhythm_pattern = static_cast<int>(rhythmPatternParam->load());
+  auto random_seed = static_cast<std::uint64_t>(randomSeed.load());
   arpseq.getArp().setType(arp_type);
   arpseq.getArp().setOctave(octave);
   arpseq.getArp().setGate(gate);
@@ -340,13 +312,30 @@ void AudioPluginAudioProcessor::hiResTimerCallback() {
   arpseq.getArp().setTransposeInterval(transpose);
   arpseq.getArp().setEuclidLegato(euclid_legato);
   arpseq.getArp().setEuclidPattern(euclid_pattern);
-  arpseq.process(deltaTime);
+  arpseq.getArp().setRhythmPattern(rhythm_pattern);
+  arpseq.getArp().setRandomSeed(random_seed);
+}
+
+Sequencer::PolyStep<POLYPHONY> AudioPluginAudioProcessor::readStepParameters(
+    int index) const {
+  Sequencer::PolyStep<POLYPHONY> step;
+  step.enabled =
+      static_cast<bool>(getStepParamValue(index, StepField::Enabled));
+
+  for (int j = 0; j < POLYPHONY; ++j) {
+    step.setNote(
+        j, {.number =
+                static_cast<int>(getStepParamValue(index, StepField::Note, j)),
+            .velocity = static_cast<int>(
+                getStepParamValue(index, StepField::Velocity, j)),
+            .offset = getStepParamValue(index, StepField::Offset, j),
+            .length = getStepParamValue(index, StepField::Length, j)});
+  }
+  return step;
 }
 
 void AudioPluginAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer,
                                              juce::MidiBuffer& midiMessages) {
-  juce::ignoreUnused(midiMessages);
-
   juce::ScopedNoDenormals noDenormals;
   auto totalNumInputChannels = getTotalNumInputChannels();
   auto totalNumOutputChannels = getTotalNumOutputChannels();
@@ -372,56 +361,32 @@ void AudioPluginAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer,
     // ..do something to the data...
   }
 
-  // MARK: process incoming MIDI messages
-
-  for (const auto metadata : midiMessages) {
-    auto message = metadata.getMessage();
-    auto time_stamp_in_seconds =
-        message.getTimeStamp() / getSampleRate() + lastCallbackTime;
-
-    if (message.isNoteOn()) {
-      message.setTimeStamp(time_stamp_in_seconds);
-      arpseq.handleNoteOn(message);
-    } else if (message.isNoteOff()) {
-      message.setTimeStamp(time_stamp_in_seconds);
-      arpseq.handleNoteOff(message);
-    }
-  }
-
-  lastCallbackTime = juce::Time::getMillisecondCounterHiRes() * 0.001;
+  // MARK: arpseq logic
+  applyParameters();
 
-  // generate MIDI start/stop/continue messages by querying DAW transport
-  // also set bpm
+  // follow DAW transport (start/stop/loop/relocate) and tempo
   if (this->wrapperType ==
       juce::AudioProcessor::WrapperType::wrapperType_VST3) {
     if (auto dawPlayHead = getPlayHead()) {
       if (auto positionInfo = dawPlayHead->getPosition()) {
         arpseq.setBpm(positionInfo->getBpm().orFallback(120.0));
 
-        // double quarter_note = positionInfo->getPpqPosition().orFallback(0.0);
-        // int ppq = static_cast<int>(quarter_note * E3_PPQ);
-
-        // if ((ppq % TICKS_PER_16TH) == 0) {
-        //   // start synced to daw (this looks very messy lol)
-        //   if (arpseq.getSyncToHost()) {
-        //     if (!arpseq.isRunning() && arpseq.shouldBeRunning()) {
-        //       arpseq.start(lastCallbackTime);
-        //     }
-        //   }
-        // }
+        // hosts without a musical position keep the internal clock
+        if (auto ppq = positionInfo->getPpqPosition()) {
+          arpseq.setHostPosition(positionInfo->getIsPlaying(), *ppq);
+        } else {
+          arpseq.setHostPosition(false, 0.0);
+        }
       }
     }
   }
 
-  // discard input MIDI messages
-  midiMessages.clear();
-
-  // overwrite MIDI buffer
-  arpMidiCollector.removeNextBlockOfMessages(midiMessages, getBlockSize());
-  // guiMidiCollector.removeNextBlockOfMessages(midiMessages, getBlockSize());
+  // consume input MIDI messages and overwrite MIDI buffer with the output
+  arpseq.processBlock(midiMessages, buffer.getNumSamples());
 
   // visualize MIDI in all channels and manual trigger
-  keyboardState.processNextMidiBuffer(midiMessages, 0, getBlockSize(), true);
+  keyboardState.processNextMidiBuffer(midiMessages, 0, buffer.getNumSamples(),
+                                      true);
 }
 
 bool AudioPluginAudioProcessor::hasEditor() const {
@@ -454,9 +419,119 @@ void AudioPluginAudioProcessor::setStateInformation(const void* data,
       getXmlFromBinary(data, sizeInBytes));
   if (xmlState.get() != nullptr) {
     if (xmlState->hasTagName(parameters.state.getType())) {
-      parameters.replaceState(juce::ValueTree::fromXml(*xmlState));
+      // only the steps the new state overwrites are ignored, they are all
+      // read again by publishPattern once the listeners are back, so an edit
+      // made meanwhile is not lost either
+      // the mask is shared with publishRecordedSteps, which may run on
+      // another thread, so only our own bits are set and cleared
+      auto state = juce::ValueTree::fromXml(*xmlState);
+      auto steps = getStepsChangedBy(state);
+      publishingSteps.fetch_or(steps);
+      parameters.replaceState(state);
+      publishingSteps.fetch_and(~steps);
+      publishPattern();
+
+      if (parameters.state.hasProperty("RANDOM_SEED")) {
+        setRandomSeed(static_cast<juce::int64>(
+            parameters.state.getProperty("RANDOM_SEED")));
+      } else {
+        setRandomSeed(randomSeed.load());  // state saved before seeds existed
+      }
+    }
+  }
+}
+
+void AudioPluginAudioProcessor::timerCallback() {
+  // only the latest version of a step is written
+  std::uint64_t steps = 0;
+  Sequencer::ArpSeq::StepChange change;
+  while (arpseq.popStepChange(change)) {
+    if (change.pass != recordingPass) {
+      publishRecordedSteps(steps);
+      steps = 0;
+      recordingPass = change.pass;
+      undoManager.beginNewTransaction("Live recording");
     }
+    recordedSteps[change.index] = change.step;
+    steps |= std::uint64_t{1} << change.index;
   }
+  publishRecordedSteps(steps);
+}
+
+void AudioPluginAudioProcessor::publishRecordedSteps(std::uint64_t steps) {
+  const auto published_steps = steps;
+  publishingSteps.fetch_or(published_steps);
+  for (; steps != 0; steps &= steps - 1) {
+    int index = std::countr_zero(steps);
+    const auto& step = recordedSteps[index];
+
+    auto p = getStepParameter(index, StepField::Enabled);
+    p->setValueNotifyingHost(static_cast<float>(step.enabled));
+
+    for (int i = 0; i < POLYPHONY; ++i) {
+      auto note = step.getNote(i);
+      p = getStepParameter(index, StepField::Note, i);
+      p->setValueNotifyingHost(
+          p->convertTo0to1(static_cast<float>(note.number)));
+
+      p = getStepParameter(index, StepField::Velocity, i);
+      p->setValueNotifyingHost(
+          p->convertTo0to1(static_cast<float>(note.velocity)));
+
+      p = getStepParameter(index, StepField::Offset, i);
+      p->setValueNotifyingHost(p->convertTo0to1(note.offset));
+
+      p = getStepParameter(index, StepField::Length, i);
+      p->setValueNotifyingHost(p->convertTo0to1(note.length));
+    }
+  }
+  publishingSteps.fetch_and(~published_steps);
+}
+
+void AudioPluginAudioProcessor::publishPattern() {
+  auto& pattern = patternSnapshots.getWriteBuffer();
+  for (int i = 0; i < STEP_SEQ_MAX_LENGTH; ++i) {
+    pattern.steps[i] = readStepParameters(i);
+  }
+  patternSnapshots.publish();
+}
+
+std::uint64_t AudioPluginAudioProcessor::getStepsChangedBy(
+    const juce::ValueTree& state) const {
+  // step parameter IDs start with "S<step>_"
+  int found[STEP_SEQ_MAX_LENGTH] = {};
+  std::uint64_t steps = 0;
+  for (const auto& child : state) {
+    auto id = child.getProperty("id").toString();
+    if (id.length() < 2 || id[0] != 'S' ||
+        !juce::CharacterFunctions::isDigit(id[1])) {
+      continue;
+    }
+    int step = id.substring(1).getIntValue();
+    auto* value = parameters.getRawParameterValue(id);
+    if (step >= STEP_SEQ_MAX_LENGTH || value == nullptr) {
+      continue;
+    }
+
+    ++found[step];
+    if (!juce::approximatelyEqual(
+            value->load(), static_cast<float>(child.getProperty("value")))) {
+      steps |= std::uint64_t{1} << step;
+    }
+  }
+
+  // parameters missing from the state are reset to their default
+  for (int step = 0; step < STEP_SEQ_MAX_LENGTH; ++step) {
+    if (found[step] != STEP_PARAMETERS_PER_STEP) {
+      steps |= std::uint64_t{1} << step;
+    }
+  }
+  return steps;
+}
+
+void AudioPluginAudioProcessor::setRandomSeed(juce::int64 seed) {
+  randomSeed = seed;
+  parameters.state.setProperty("RANDOM_SEED", seed, nullptr);
 }
 }  // namespace audio_plugin
 
@@ -0,0 +1,247 @@
+#include <PolyArp/ArpSeq.h>
+#include <gtest/gtest.h>
+#include <vector>
+
+namespace audio_plugin_test {
+using Sequencer::ArpSeq;
+
+namespace {
+int countNoteOns(const juce::MidiBuffer& buffer) {
+  int count = 0;
+  for (const auto metadata : buffer) {
+    count += metadata.getMessage().isNoteOn() ? 1 : 0;
+  }
+  return count;
+}
+}  // namespace
+
+TEST(ArpSeq, CommandsApplyOnNextBlock) {
+  ArpSeq arpseq;
+  arpseq.prepareToPlay(48000, 512);
+
+  EXPECT_TRUE(arpseq.sendCommand(ArpSeq::Command::Bpm, 90.0));
+  EXPECT_DOUBLE_EQ(arpseq.getBpm(), BPM_DEFAULT);  // not applied yet
+
+  juce::MidiBuffer buffer;
+  arpseq.processBlock(buffer, 512);
+  EXPECT_DOUBLE_EQ(arpseq.getBpm(), 90.0);
+}
+
+TEST(ArpSeq, ContinuousCommandsKeepTheLatestValue) {
+  ArpSeq arpseq;
+  arpseq.prepareToPlay(48000, 512);
+
+  // far more than the command queue holds
+  for (int i = 0; i < 2 * COMMAND_QUEUE_SIZE; ++i) {
+    EXPECT_TRUE(arpseq.sendCommand(ArpSeq::Command::Bpm, 60.0 + i % 100));
+  }
+  EXPECT_TRUE(arpseq.sendCommand(ArpSeq::Command::Hold, 1));
+
+  juce::MidiBuffer buffer;
+  arpseq.processBlock(buffer, 512);
+  EXPECT_DOUBLE_EQ(arpseq.getBpm(), 60.0 + (2 * COMMAND_QUEUE_SIZE - 1) % 100);
+}
+
+TEST(ArpSeq, OutputQueueReportsDepth) {
+  ArpSeq arpseq;
+  arpseq.prepareToPlay(48000, 512);
+
+  juce::MidiBuffer buffer;
+  for (int note = 60; note < 64; ++note) {
+    buffer.addEvent(juce::MidiMessage::noteOn(1, note, juce::uint8{100}),
+                    note - 60);
+  }
+  arpseq.processBlock(buffer, 512);
+
+  EXPECT_EQ(countNoteOns(buffer), 4);
+  EXPECT_EQ(arpseq.getOutputMaxDepth(), 4);
+  EXPECT_EQ(arpseq.getOutputOverflowCount(), 0);
+
+  arpseq.resetOutputStats();
+  EXPECT_EQ(arpseq.getOutputMaxDepth(), 0);
+}
+
+TEST(ArpSeq, NoteRingingAcrossLoopEndStopsOnTime) {
+  ArpSeq arpseq;
+  arpseq.prepareToPlay(48000, 500);  // 120 bpm: a tick is 250 samples
+  arpseq.getSeq().setLength(4);
+
+  // the note off is due 3/4 step after the loop wrapped
+  auto step = arpseq.getSeq().getStepAtIndex(3);
+  step.enabled = true;
+  step.setNote(0, {.number = 60, .velocity = 100, .offset = 0.f,
+                   .length = 0.75f});
+  arpseq.getSeq().setStepAtIndex(3, step);
+  arpseq.setSequencerPlay(true);
+
+  juce::int64 note_on = -1;
+  juce::int64 note_off = -1;
+  juce::int64 block_start = 0;
+  juce::MidiBuffer buffer;
+  while (note_off < 0 && block_start < 48000 * 4) {
+    arpseq.processBlock(buffer, 500);
+    for (const auto metadata : buffer) {
+      auto message = metadata.getMessage();
+      if (message.getNoteNumber() == 60) {
+        (message.isNoteOn() ? note_on : note_off) =
+            block_start + metadata.samplePosition;
+      }
+    }
+    buffer.clear();
+    block_start += 500;
+  }
+
+  ASSERT_GE(note_on, 0);
+  EXPECT_EQ(note_off - note_on, 18 * 250);
+}
+
+TEST(ArpSeq, IdleTicksSkippedAcrossBlocksKeepTiming) {
+  // the same pattern rendered in tiny and in huge blocks, with idle ticks
+  // skipped inside and across them
+  auto render = [](int block_size) {
+    ArpSeq arpseq;
+    arpseq.prepareToPlay(48000, block_size);
+    arpseq.getSeq().setLength(4);
+    for (int index = 0; index < 4; index += 2) {
+      auto step = arpseq.getSeq().getStepAtIndex(index);
+      step.enabled = true;
+      step.setNote(0, {.number = 60 + index, .velocity = 100,
+                       .offset = 0.25f * static_cast<float>(index),
+                       .length = 0.3f});
+      arpseq.getSeq().setStepAtIndex(index, step);
+    }
+    arpseq.setSequencerPlay(true);
+
+    std::vector<juce::int64> times;
+    juce::int64 block_start = 0;
+    juce::MidiBuffer buffer;
+    while (block_start < 48000 * 2) {
+      arpseq.processBlock(buffer, block_size);
+      for (const auto metadata : buffer) {
+        if (block_start + metadata.samplePosition < 48000 * 2) {
+          times.push_back(block_start + metadata.samplePosition);
+        }
+      }
+      buffer.clear();
+      block_start += block_size;
+    }
+    return times;
+  };
+
+  auto times = render(4096);
+  EXPECT_EQ(times.size(), 16u);
+  EXPECT_EQ(render(7), times);
+  EXPECT_EQ(render(1), times);
+}
+
+TEST(ArpSeq, OffsetsPlayBetweenTicks) {
+  ArpSeq arpseq;
+  arpseq.prepareToPlay(48000, 37);  // 120 bpm: a step is 6000 samples
+  auto place = [&arpseq](int index, int number, float offset, float length) {
+    auto step = arpseq.getSeq().getStepAtIndex(index);
+    step.enabled = true;
+    step.setNote(0, {.number = number, .velocity = 100, .offset = offset,
+                     .length = length});
+    arpseq.getSeq().setStepAtIndex(index, step);
+  };
+  place(0, 60, 0.f, 0.5f);
+  place(1, 62, 0.15f, 0.4f);  // 0.6 tick after a tick at 96 ppqn
+  arpseq.setSequencerPlay(true);
+
+  juce::int64 times[128][2] = {};
+  juce::int64 block_start = 0;
+  juce::MidiBuffer buffer;
+  while (block_start < 12000) {
+    arpseq.processBlock(buffer, 37);  // ticks are deferred across blocks
+    for (const auto metadata : buffer) {
+      auto message = metadata.getMessage();
+      times[message.getNoteNumber()][message.isNoteOn() ? 0 : 1] =
+          block_start + metadata.samplePosition;
+    }
+    buffer.clear();
+    block_start += 37;
+  }
+
+  // within a sample, ticks themselves fall on whole samples
+  EXPECT_NEAR(times[62][0] - times[60][0], 6900, 1);
+  EXPECT_NEAR(times[62][1] - times[62][0], 2400, 1);
+}
+
+TEST(ArpSeq, PatternIsSwappedInOnTheNextStep) {
+  ArpSeq arpseq;
+  arpseq.prepareToPlay(48000, 1000);  // 120 bpm: a step is 6000 samples
+
+  ArpSeq::Pattern pattern{};
+  pattern.steps[2].enabled = true;
+
+  // stopped: right away
+  arpseq.setSequencerPattern(pattern);
+  EXPECT_TRUE(arpseq.getSeq().getStepAtIndex(2).enabled);
+
+  pattern.steps[2].enabled = false;
+  arpseq.setSequencerPlay(true);
+  juce::MidiBuffer buffer;
+  arpseq.processBlock(buffer, 1000);  // inside step 0
+
+  arpseq.setSequencerPattern(pattern);
+  auto step = pattern.steps[3];
+  step.enabled = true;
+  arpseq.setSequencerStep(3, step);  // edits land with the pattern
+  EXPECT_TRUE(arpseq.getSeq().getStepAtIndex(2).enabled);
+  EXPECT_FALSE(arpseq.getSeq().getStepAtIndex(3).enabled);
+
+  for (int block = 0; block < 6; ++block) {
+    arpseq.processBlock(buffer, 1000);  // past the grid of step 1
+  }
+  EXPECT_FALSE(arpseq.getSeq().getStepAtIndex(2).enabled);
+  EXPECT_TRUE(arpseq.getSeq().getStepAtIndex(3).enabled);
+}
+
+TEST(ArpSeq, SequencerStepIndexIsPublishedPerBlock) {
+  ArpSeq arpseq;
+  arpseq.prepareToPlay(48000, 1000);  // 120 bpm: a step is 6000 samples
+  arpseq.setSequencerPlay(true);
+
+  juce::MidiBuffer buffer;
+  for (int block = 0; block < 13; ++block) {
+    arpseq.processBlock(buffer, 1000);
+    buffer.clear();
+  }
+  EXPECT_EQ(arpseq.getSequencerStepIndex(), 2);
+}
+
+TEST(ArpSeq, RecordedStepsArePublishedOncePerBlock) {
+  ArpSeq arpseq;
+  arpseq.prepareToPlay(48000, 512);
+  arpseq.setSequencerPlay(true);
+  arpseq.setSequencerArmed(true);
+
+  // two notes recorded into the same step give a single change
+  juce::MidiBuffer buffer;
+  buffer.addEvent(juce::MidiMessage::noteOn(1, 60, juce::uint8{100}), 0);
+  buffer.addEvent(juce::MidiMessage::noteOn(1, 64, juce::uint8{100}), 1);
+  buffer.addEvent(juce::MidiMessage::noteOff(1, 60), 100);
+  buffer.addEvent(juce::MidiMessage::noteOff(1, 64), 101);
+  arpseq.processBlock(buffer, 512);
+
+  ArpSeq::StepChange change;
+  ASSERT_TRUE(arpseq.popStepChange(change));
+  EXPECT_EQ(change.pass, 1u);
+  EXPECT_EQ(change.index, 0);
+  EXPECT_TRUE(change.step.enabled);
+  EXPECT_EQ(change.step.getNote(0).number, 64);
+  EXPECT_EQ(change.step.getNote(1).number, 60);
+  EXPECT_FALSE(arpseq.popStepChange(change));
+
+  // arming again starts a new pass
+  arpseq.setSequencerArmed(false);
+  arpseq.setSequencerArmed(true);
+  buffer.clear();
+  buffer.addEvent(juce::MidiMessage::noteOn(1, 67, juce::uint8{100}), 0);
+  buffer.addEvent(juce::MidiMessage::noteOff(1, 67), 10);
+  arpseq.processBlock(buffer, 512);
+
+  ASSERT_TRUE(arpseq.popStepChange(change));
+  EXPECT_EQ(change.pass, 2u);
+}
+}  // namespace audio_plugin_test
@@ -0,0 +1,52 @@
+#include <PolyArp/CircularBuffer.h>
+#include <gtest/gtest.h>
+#include <thread>
+
+namespace audio_plugin_test {
+using Sequencer::CircularBuffer;
+
+TEST(CircularBuffer, PushFailsWhenFull) {
+  CircularBuffer<int, 4> buffer;
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(buffer.push(i));
+  }
+  EXPECT_FALSE(buffer.push(4));
+  EXPECT_EQ(buffer.size(), 4);
+
+  int item = -1;
+  EXPECT_TRUE(buffer.pop(item));
+  EXPECT_EQ(item, 0);
+  EXPECT_TRUE(buffer.push(4));
+
+  for (int expected = 1; expected <= 4; ++expected) {
+    EXPECT_TRUE(buffer.pop(item));
+    EXPECT_EQ(item, expected);
+  }
+  EXPECT_FALSE(buffer.pop(item));
+  EXPECT_TRUE(buffer.empty());
+}
+
+TEST(CircularBuffer, ItemsCrossThreadsInOrder) {
+  constexpr int NUM_ITEMS = 100000;
+  CircularBuffer<int, 64> buffer;
+
+  std::thread producer([&buffer] {
+    for (int i = 0; i < NUM_ITEMS; ++i) {
+      while (!buffer.push(i)) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  int expected = 0;
+  int item = 0;
+  while (expected < NUM_ITEMS) {
+    if (buffer.pop(item)) {
+      ASSERT_EQ(item, expected);
+      ++expected;
+    }
+  }
+  producer.join();
+  EXPECT_TRUE(buffer.empty());
+}
+}  // namespace audio_plugin_test
@@ -0,0 +1,146 @@
+#include <PolyArp/EventQueue.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+
+// replays the event traffic of Part::renderNote/tick for a Chord arp
+// (every note of the chord rendered on every step) with both queues: the old
+// search and rebase of a MidiMessageSequence, and what Part does with
+// EventQueue (note offs removed by handle, events on absolute ticks)
+
+namespace audio_plugin_test {
+namespace {
+constexpr int TICKS_PER_STEP = 24;
+constexpr int LOOP_LENGTH = 16;  // steps
+constexpr int NUM_STEPS = 4096;
+constexpr int GATE_TICKS = 18;
+
+// the implementation Part used before EventQueue
+int runMidiMessageSequence(int notesPerStep) {
+  juce::MidiMessageSequence queue, queue_next;
+  int num_sent = 0;
+  int tick = 0;
+
+  for (int step = 0; step < NUM_STEPS; ++step) {
+    int step_index = step % LOOP_LENGTH;
+    for (int n = 0; n < notesPerStep; ++n) {
+      int note = 24 + n;
+      int note_on_tick = step_index * TICKS_PER_STEP;
+
+      bool note_off_deleted = false;
+      for (int i = queue.getNextIndexAtTime(tick); i < queue.getNumEvents();
+           ++i) {
+        auto message = queue.getEventPointer(i)->message;
+        if (message.isNoteOff() && message.getNoteNumber() == note) {
+          queue.deleteEvent(i, false);
+          note_off_deleted = true;
+        }
+      }
+      if (note_off_deleted) {
+        queue.addEvent(juce::MidiMessage::noteOff(1, note).withTimeStamp(
+            note_on_tick));
+      }
+      queue.addEvent(
+          juce::MidiMessage::noteOn(1, note, static_cast<juce::uint8>(100))
+              .withTimeStamp(note_on_tick));
+      queue.addEvent(juce::MidiMessage::noteOff(1, note).withTimeStamp(
+          note_on_tick + GATE_TICKS));
+    }
+
+    for (int t = 0; t < TICKS_PER_STEP; ++t) {
+      for (int i = queue.getNextIndexAtTime(tick);
+           i < queue.getNextIndexAtTime(tick + 1); ++i) {
+        ++num_sent;
+      }
+      ++tick;
+    }
+
+    if (step_index == LOOP_LENGTH - 1) {
+      queue.addTimeToMessages(-tick);
+      for (const auto& midi_event : queue) {
+        if (midi_event->message.getTimeStamp() >= 0) {
+          queue_next.addEvent(midi_event->message);
+        }
+      }
+      queue.swapWith(queue_next);
+      queue_next.clear();
+      tick = 0;
+    }
+  }
+  return num_sent;
+}
+
+int runEventQueue(int notesPerStep) {
+  static Sequencer::EventQueue<512> queue;
+  queue.clear();
+  bool has_note_off[128] = {};
+  Sequencer::EventHandle note_offs[128] = {};
+  int num_sent = 0;
+  std::int64_t tick = 0;  // never rebased, the loop start moves instead
+  std::int64_t loop_origin = 0;
+
+  for (int step = 0; step < NUM_STEPS; ++step) {
+    int step_index = step % LOOP_LENGTH;
+    for (int n = 0; n < notesPerStep; ++n) {
+      int note = 24 + n;
+      auto note_on_tick = loop_origin + step_index * TICKS_PER_STEP;
+
+      if (has_note_off[note]) {
+        queue.remove(note_offs[note]);
+        queue.push(Sequencer::MidiEvent::noteOff(note_on_tick, 1, note, 0));
+      }
+      queue.push(Sequencer::MidiEvent::noteOn(note_on_tick, 1, note, 100));
+      has_note_off[note] = queue.push(
+          Sequencer::MidiEvent::noteOff(note_on_tick + GATE_TICKS, 1, note, 0),
+          &note_offs[note]);
+    }
+
+    Sequencer::MidiEvent event{};
+    Sequencer::EventHandle handle = 0;
+    for (int t = 0; t < TICKS_PER_STEP; ++t) {
+      while (queue.popDue(tick, event, &handle)) {
+        int note = event.getNoteNumber();
+        if (event.isNoteOff() && has_note_off[note] &&
+            note_offs[note] == handle) {
+          has_note_off[note] = false;
+        }
+        ++num_sent;
+      }
+      ++tick;
+    }
+
+    if (step_index == LOOP_LENGTH - 1) {
+      loop_origin = tick;
+    }
+  }
+  return num_sent;
+}
+
+template <typename Function>
+double measureNanosecondsPerStep(Function&& function, int& result) {
+  auto start = std::chrono::steady_clock::now();
+  result = function();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         NUM_STEPS;
+}
+}  // namespace
+
+TEST(EventQueueBenchmark, ChordDensity) {
+  for (int notes_per_step : {4, 12, 24, 48}) {
+    int sent_sequence = 0;
+    int sent_queue = 0;
+    double sequence_ns = measureNanosecondsPerStep(
+        [&] { return runMidiMessageSequence(notes_per_step); }, sent_sequence);
+    double queue_ns = measureNanosecondsPerStep(
+        [&] { return runEventQueue(notes_per_step); }, sent_queue);
+
+    EXPECT_EQ(sent_sequence, sent_queue);
+    std::printf(
+        "%2d notes/step: MidiMessageSequence %9.0f ns/step, EventQueue %7.0f "
+        "ns/step (x%.1f)\n",
+        notes_per_step, sequence_ns, queue_ns, sequence_ns / queue_ns);
+  }
+}
+}  // namespace audio_plugin_test
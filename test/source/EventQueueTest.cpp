@@ -0,0 +1,76 @@
+#include <PolyArp/EventQueue.h>
+#include <gtest/gtest.h>
+
+namespace audio_plugin_test {
+using Sequencer::EventQueue;
+using Sequencer::MidiEvent;
+
+TEST(EventQueue, PopsInTickOrderThenInsertionOrder) {
+  EventQueue<16> queue;
+  queue.push(MidiEvent::noteOff(10, 1, 60, 100));
+  queue.push(MidiEvent::noteOn(5, 1, 62, 100));
+  queue.push(MidiEvent::noteOff(5, 1, 64, 100));
+  queue.push(MidiEvent::noteOn(5, 1, 64, 100));
+
+  MidiEvent event{};
+  EXPECT_FALSE(queue.popDue(4, event));
+
+  ASSERT_TRUE(queue.popDue(5, event));
+  EXPECT_EQ(event.getNoteNumber(), 62);
+  ASSERT_TRUE(queue.popDue(5, event));
+  EXPECT_TRUE(event.isNoteOff());
+  ASSERT_TRUE(queue.popDue(5, event));
+  EXPECT_TRUE(event.isNoteOn());
+  EXPECT_FALSE(queue.popDue(5, event));
+
+  ASSERT_TRUE(queue.popDue(10, event));
+  EXPECT_EQ(event.getNoteNumber(), 60);
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(EventQueue, HandlesFindAndRemoveQueuedEvents) {
+  EventQueue<8> queue;
+  Sequencer::EventHandle handles[6];
+  for (int i = 0; i < 6; ++i) {
+    ASSERT_TRUE(queue.push(MidiEvent::noteOff(10 - i, 1, 60 + i, 100),
+                           &handles[i]));
+  }
+  EXPECT_EQ(queue.get(handles[2]).getNoteNumber(), 62);
+
+  queue.remove(handles[2]);
+  queue.remove(handles[5]);
+  EXPECT_EQ(queue.size(), 4);
+  EXPECT_EQ(queue.get(handles[4]).getNoteNumber(), 64);
+
+  // popped events report the handle they were queued with
+  MidiEvent event{};
+  Sequencer::EventHandle handle = -1;
+  ASSERT_TRUE(queue.popDue(10, event, &handle));
+  EXPECT_EQ(event.getNoteNumber(), 64);
+  EXPECT_EQ(handle, handles[4]);
+
+  // handles are reused once their event is gone, never while it is queued
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_TRUE(queue.push(MidiEvent::noteOn(20, 1, 70 + i, 100), &handle));
+    EXPECT_NE(handle, handles[0]);
+    EXPECT_NE(handle, handles[1]);
+    EXPECT_NE(handle, handles[3]);
+  }
+  EXPECT_TRUE(queue.full());
+  EXPECT_EQ(queue.get(handles[3]).getNoteNumber(), 63);
+
+  queue.clear();
+  for (int i = 0; i < 8; ++i) {
+    EXPECT_TRUE(queue.push(MidiEvent::noteOn(i, 1, 60, 100)));
+  }
+}
+
+TEST(EventQueue, RejectsEventsWhenFull) {
+  EventQueue<4> queue;
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(queue.push(MidiEvent::noteOn(i, 1, 60, 100)));
+  }
+  EXPECT_FALSE(queue.push(MidiEvent::noteOn(0, 1, 60, 100)));
+  EXPECT_EQ(queue.size(), 4);
+}
+}  // namespace audio_plugin_test
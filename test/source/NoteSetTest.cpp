@@ -0,0 +1,66 @@
+#include <PolyArp/NoteSet.h>
+#include <gtest/gtest.h>
+#include <set>
+
+namespace audio_plugin_test {
+using Sequencer::NoteSet;
+
+TEST(NoteSet, EmptySetHasNoNeighbours) {
+  NoteSet notes;
+  EXPECT_TRUE(notes.empty());
+  EXPECT_EQ(notes.lowest(), NoteSet::NONE);
+  EXPECT_EQ(notes.highest(), NoteSet::NONE);
+  EXPECT_EQ(notes.higherThan(60), NoteSet::NONE);
+  EXPECT_EQ(notes.lowerThan(60), NoteSet::NONE);
+}
+
+TEST(NoteSet, NeighbourQueriesMatchOrderedSet) {
+  NoteSet notes;
+  std::set<int> reference;
+  for (int note : {0, 1, 40, 63, 64, 65, 100, 127}) {
+    notes.insert(note);
+    reference.insert(note);
+  }
+  notes.erase(40);
+  reference.erase(40);
+
+  EXPECT_EQ(notes.size(), static_cast<int>(reference.size()));
+  EXPECT_EQ(notes.lowest(), 0);
+  EXPECT_EQ(notes.highest(), 127);
+
+  for (int note = 0; note < 128; ++note) {
+    EXPECT_EQ(notes.contains(note), reference.count(note) == 1);
+
+    auto higher = reference.upper_bound(note);
+    EXPECT_EQ(notes.higherThan(note),
+              higher == reference.end() ? NoteSet::NONE : *higher);
+
+    auto lower = reference.lower_bound(note);
+    EXPECT_EQ(notes.lowerThan(note),
+              lower == reference.begin() ? NoteSet::NONE : *std::prev(lower));
+  }
+}
+
+TEST(NoteSet, NotesOutOfRangeAreNeverInTheSet) {
+  NoteSet notes;
+  for (int note : {-5, 128, 163}) {
+    notes.insert(note);
+  }
+  EXPECT_TRUE(notes.empty());
+
+  notes.insert(0);
+  notes.insert(127);
+  for (int note : {-5, 128, 163}) {
+    EXPECT_FALSE(notes.contains(note));
+    notes.erase(note);
+  }
+  EXPECT_EQ(notes.size(), 2);
+
+  EXPECT_EQ(notes.higherThan(-5), 0);
+  EXPECT_EQ(notes.higherThan(128), NoteSet::NONE);
+  EXPECT_EQ(notes.higherThan(163), NoteSet::NONE);
+  EXPECT_EQ(notes.lowerThan(-5), NoteSet::NONE);
+  EXPECT_EQ(notes.lowerThan(128), 127);
+  EXPECT_EQ(notes.lowerThan(163), 127);
+}
+}  // namespace audio_plugin_test
@@ -0,0 +1,46 @@
+#include <PolyArp/Random.h>
+#include <gtest/gtest.h>
+
+namespace audio_plugin_test {
+using Sequencer::RandomStream;
+
+TEST(RandomStream, MatchesPcg32Reference) {
+  // first outputs of pcg32-demo seeded with (42, 54)
+  RandomStream random(42, 54);
+  EXPECT_EQ(random.next(), 0xa15c02b7u);
+  EXPECT_EQ(random.next(), 0x7b47f409u);
+  EXPECT_EQ(random.next(), 0xba1d3330u);
+}
+
+TEST(RandomStream, SameSeedReplays) {
+  RandomStream a(1234, 0);
+  RandomStream b(1234, 0);
+  RandomStream other_stream(1234, 1);
+
+  int num_different = 0;
+  for (int i = 0; i < 100; ++i) {
+    auto value = a.next();
+    EXPECT_EQ(value, b.next());
+    num_different += value != other_stream.next();
+  }
+  EXPECT_GT(num_different, 90);
+
+  a.setSeed(1234, 0);
+  b.setSeed(1234, 0);
+  EXPECT_EQ(a.nextInt(7), b.nextInt(7));
+}
+
+TEST(RandomStream, NextIntStaysInRange) {
+  RandomStream random(7);
+  int counts[5] = {};
+  for (int i = 0; i < 5000; ++i) {
+    int value = random.nextInt(5);
+    ASSERT_GE(value, 0);
+    ASSERT_LT(value, 5);
+    ++counts[value];
+  }
+  for (int count : counts) {
+    EXPECT_GT(count, 800);
+  }
+}
+}  // namespace audio_plugin_test
@@ -0,0 +1,63 @@
+#include <PolyArp/Rhythm.h>
+#include <gtest/gtest.h>
+
+namespace audio_plugin_test {
+using Sequencer::Rhythm;
+
+// the tables are constexpr, spot check them at compile time as well
+static_assert(Rhythm::Euclidean(3, 8).getMask() == 0b00101001);
+static_assert(Rhythm::Euclidean(0, 16).getMask() == 0);
+static_assert(Rhythm::Yarns(0).getMask() == 0x5555);
+
+TEST(Rhythm, EuclideanMatchesYarnsTable) {
+  // first entries of the euclidean lookup table generated by script/yarns.py
+  EXPECT_EQ(Rhythm::Euclidean(2, 5).getMask(), 0b01001u);
+  EXPECT_EQ(Rhythm::Euclidean(3, 7).getMask(), 0b0101001u);
+  EXPECT_EQ(Rhythm::Euclidean(5, 8).getMask(), 0b10101101u);
+  EXPECT_EQ(Rhythm::Euclidean(32, 32).getMask(), 0xffffffffu);
+
+  for (int length = 1; length <= RHYTHM_MAX_LENGTH; ++length) {
+    for (int fill = 0; fill <= length; ++fill) {
+      auto rhythm = Rhythm::Euclidean(fill, length);
+      EXPECT_EQ(std::popcount(rhythm.getMask()), fill);
+      EXPECT_EQ(rhythm.isPulse(0), fill > 0);
+    }
+  }
+}
+
+TEST(Rhythm, RotationShiftsStepsBack) {
+  auto rhythm = Rhythm::Euclidean(3, 8);
+  auto rotated = Rhythm::Euclidean(3, 8, 2);
+  auto rotated_back = Rhythm::Euclidean(3, 8, -6);
+  for (int i = 0; i < 16; ++i) {
+    EXPECT_EQ(rotated.isPulse(i), rhythm.isPulse(i + 2));
+    EXPECT_EQ(rotated_back.isPulse(i), rotated.isPulse(i));
+  }
+}
+
+TEST(Rhythm, StepsToNextPulseWrapsAround) {
+  auto rhythm = Rhythm::Euclidean(3, 8);  // x..x.x..
+  int expected[] = {3, 2, 1, 2, 1, 3, 2, 1};
+  for (int i = 0; i < 24; ++i) {
+    EXPECT_EQ(rhythm.getStepsToNextPulse(i), expected[i % 8]);
+  }
+
+  EXPECT_EQ(Rhythm::Euclidean(1, 32).getStepsToNextPulse(0), 32);
+  EXPECT_EQ(Rhythm::Euclidean(0, 4).getStepsToNextPulse(1), 0);
+  EXPECT_EQ(Rhythm().getStepsToNextPulse(12345), 1);
+}
+
+TEST(Rhythm, YarnsPatternsMatchXoxStrings) {
+  // same values as XoxTo16BitInt in script/yarns.py
+  EXPECT_EQ(Sequencer::XoxPattern("o-o- oooo o-o- oooo"), 0xf5f5u);
+  EXPECT_EQ(Sequencer::XoxPattern("o--- ---- o--- o-oo"), 0xd101u);
+
+  for (int pattern = 0; pattern < YARNS_NUM_PATTERNS; ++pattern) {
+    auto rhythm = Rhythm::Yarns(pattern);
+    EXPECT_EQ(rhythm.getLength(), YARNS_PATTERN_LENGTH);
+    EXPECT_TRUE(rhythm.isPulse(0));  // every pattern starts on the downbeat
+  }
+  EXPECT_EQ(Rhythm::Yarns(1).getMask(), 0xf5f5u);
+  EXPECT_EQ(Rhythm::Yarns(21).getMask(), 0xd101u);
+}
+}  // namespace audio_plugin_test
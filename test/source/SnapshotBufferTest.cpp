@@ -0,0 +1,63 @@
+#include <PolyArp/SnapshotBuffer.h>
+#include <gtest/gtest.h>
+#include <thread>
+
+namespace audio_plugin_test {
+using Sequencer::SnapshotBuffer;
+
+TEST(SnapshotBuffer, ReaderSeesLatestPublishedVersion) {
+  SnapshotBuffer<int> buffer;
+  EXPECT_FALSE(buffer.update());
+
+  buffer.getWriteBuffer() = 1;
+  buffer.publish();
+  buffer.getWriteBuffer() = 2;
+  buffer.publish();
+
+  EXPECT_TRUE(buffer.update());
+  EXPECT_EQ(buffer.read(), 2);
+  EXPECT_FALSE(buffer.update());
+  EXPECT_EQ(buffer.read(), 2);
+
+  // the version being read is never handed back to the writer
+  buffer.getWriteBuffer() = 3;
+  buffer.publish();
+  buffer.getWriteBuffer() = 4;
+  EXPECT_EQ(buffer.read(), 2);
+}
+
+TEST(SnapshotBuffer, VersionsCrossThreadsWhole) {
+  struct Version {
+    int number;
+    int values[64];
+  };
+  constexpr int NUM_VERSIONS = 20000;
+  SnapshotBuffer<Version> buffer;
+
+  std::thread writer([&buffer] {
+    for (int number = 1; number <= NUM_VERSIONS; ++number) {
+      auto& version = buffer.getWriteBuffer();
+      version.number = number;
+      for (auto& value : version.values) {
+        value = number;
+      }
+      buffer.publish();
+    }
+  });
+
+  int last = 0;
+  bool whole = true;
+  while (last < NUM_VERSIONS) {
+    if (buffer.update()) {
+      const auto& version = buffer.read();
+      for (auto value : version.values) {
+        whole = whole && value == version.number;
+      }
+      ASSERT_GT(version.number, last);
+      last = version.number;
+    }
+  }
+  writer.join();
+  EXPECT_TRUE(whole);
+}
+}  // namespace audio_plugin_test
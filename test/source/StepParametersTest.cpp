@@ -0,0 +1,53 @@
+#include <PolyArp/StepParameters.h>
+#include <gtest/gtest.h>
+#include <string>
+
+namespace audio_plugin_test {
+using audio_plugin::GetStepParameterID;
+using audio_plugin::GetStepParameterIndex;
+using audio_plugin::StepField;
+
+static_assert(GetStepParameterIndex(0, StepField::Enabled) == 0);
+static_assert(GetStepParameterIndex(0, StepField::Note) == 1);
+static_assert(GetStepParameterIndex(1, StepField::Enabled) ==
+              audio_plugin::STEP_PARAMETERS_PER_STEP);
+
+TEST(StepParameters, IDsMatchTheFormerStringFormat) {
+  EXPECT_STREQ(GetStepParameterID(0, StepField::Enabled), "S0_ENABLED");
+  EXPECT_STREQ(GetStepParameterID(12, StepField::Velocity, 3),
+               "S12_N3_VELOCITY");
+
+  for (int step = 0; step < STEP_SEQ_MAX_LENGTH; ++step) {
+    std::string prefix = "S" + std::to_string(step) + "_";
+    EXPECT_EQ(GetStepParameterID(step, StepField::Enabled),
+              prefix + "ENABLED");
+    for (int note = 0; note < POLYPHONY; ++note) {
+      std::string note_prefix = prefix + "N" + std::to_string(note) + "_";
+      EXPECT_EQ(GetStepParameterID(step, StepField::Note, note),
+                note_prefix + "NOTE");
+      EXPECT_EQ(GetStepParameterID(step, StepField::Velocity, note),
+                note_prefix + "VELOCITY");
+      EXPECT_EQ(GetStepParameterID(step, StepField::Offset, note),
+                note_prefix + "OFFSET");
+      EXPECT_EQ(GetStepParameterID(step, StepField::Length, note),
+                note_prefix + "LENGTH");
+    }
+  }
+}
+
+TEST(StepParameters, IndicesAreDenseAndInLayoutOrder) {
+  int expected = 0;
+  for (int step = 0; step < STEP_SEQ_MAX_LENGTH; ++step) {
+    EXPECT_EQ(GetStepParameterIndex(step, StepField::Enabled), expected++);
+    for (int note = 0; note < POLYPHONY; ++note) {
+      for (auto field : {StepField::Note, StepField::Velocity,
+                         StepField::Offset, StepField::Length}) {
+        EXPECT_EQ(GetStepParameterIndex(step, field, note), expected);
+        EXPECT_EQ(audio_plugin::GetStepOfParameter(expected), step);
+        ++expected;
+      }
+    }
+  }
+  EXPECT_EQ(expected, audio_plugin::NUM_STEP_PARAMETERS);
+}
+}  // namespace audio_plugin_test
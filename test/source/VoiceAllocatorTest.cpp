@@ -0,0 +1,120 @@
+#include <PolyArp/VoiceLimiter.h>
+#include <gtest/gtest.h>
+#include <vector>
+
+namespace audio_plugin_test {
+using Sequencer::Priority;
+using Sequencer::VoiceLimiter;
+using StealingPolicy = VoiceLimiter::StealingPolicy;
+
+namespace {
+std::vector<int> activeNotes(const VoiceLimiter& limiter) {
+  std::vector<int> notes;
+  for (int note : limiter.getActiveNotes()) {
+    notes.push_back(note);
+  }
+  return notes;
+}
+}  // namespace
+
+TEST(VoiceLimiter, StealsLeastRecentlyUsedVoice) {
+  VoiceLimiter limiter(3);
+  for (int note : {60, 64, 67}) {
+    EXPECT_TRUE(limiter.noteOn(note, Priority::Sequencer, StealingPolicy::LRU));
+  }
+  EXPECT_TRUE(limiter.noteOn(64, Priority::Sequencer, StealingPolicy::LRU));
+
+  int stolen_note = -1;
+  EXPECT_TRUE(limiter.noteOn(72, Priority::Sequencer, StealingPolicy::LRU,
+                             &stolen_note));
+  EXPECT_EQ(stolen_note, 60);
+  EXPECT_EQ(activeNotes(limiter), (std::vector<int>{67, 64, 72}));
+}
+
+TEST(VoiceLimiter, StealsClosestVoiceAndOlderOnTie) {
+  VoiceLimiter limiter(2);
+  limiter.noteOn(62, Priority::Sequencer, StealingPolicy::Closest);
+  limiter.noteOn(58, Priority::Sequencer, StealingPolicy::Closest);
+
+  int stolen_note = -1;
+  EXPECT_TRUE(limiter.noteOn(60, Priority::Sequencer, StealingPolicy::Closest,
+                             &stolen_note));
+  EXPECT_EQ(stolen_note, 62);
+  EXPECT_EQ(limiter.getNumActiveVoices(), 2u);
+}
+
+TEST(VoiceLimiter, SequencerCannotStealKeyboardVoices) {
+  VoiceLimiter limiter(1);
+  EXPECT_TRUE(limiter.noteOn(60, Priority::Keyboard, StealingPolicy::Closest));
+  EXPECT_FALSE(
+      limiter.tryNoteOn(61, Priority::Sequencer, StealingPolicy::Closest));
+  EXPECT_FALSE(limiter.noteOff(60, Priority::Sequencer));
+  EXPECT_TRUE(limiter.noteOff(60, Priority::Keyboard));
+  EXPECT_EQ(limiter.getNumActiveVoices(), 0u);
+}
+}  // namespace audio_plugin_test
+
+namespace audio_plugin_test {
+using Sequencer::VoiceAllocator;
+
+TEST(VoiceAllocator, ReusesVoiceReleasedLongestAgo) {
+  VoiceAllocator<4> allocator;
+  int voices[3];
+  for (int i = 0; i < 3; ++i) {
+    allocator.noteOn(60 + i, Priority::Sequencer,
+                     VoiceAllocator<4>::StealingPolicy::LRU, nullptr,
+                     &voices[i]);
+  }
+  EXPECT_EQ(voices[0], 0);
+  EXPECT_EQ(voices[1], 1);
+  EXPECT_EQ(voices[2], 2);
+
+  allocator.noteOff(61, Priority::Sequencer);
+  allocator.noteOff(60, Priority::Sequencer);
+
+  int voice = VoiceAllocator<4>::NO_VOICE;
+  allocator.noteOn(70, Priority::Sequencer,
+                   VoiceAllocator<4>::StealingPolicy::LRU, nullptr, &voice);
+  EXPECT_EQ(voice, 3);  // never used
+  allocator.noteOn(71, Priority::Sequencer,
+                   VoiceAllocator<4>::StealingPolicy::LRU, nullptr, &voice);
+  EXPECT_EQ(voice, 1);  // released before voice 0
+  EXPECT_EQ(allocator.getVoiceForNote(71), 1);
+}
+
+TEST(VoiceAllocator, StolenNoteKeepsItsVoice) {
+  using Allocator = VoiceAllocator<8>;
+  Allocator allocator(2);
+  allocator.noteOn(60, Priority::Sequencer, Allocator::StealingPolicy::MRU);
+  allocator.noteOn(64, Priority::Sequencer, Allocator::StealingPolicy::MRU);
+
+  int stolen_note = -1;
+  int voice = Allocator::NO_VOICE;
+  EXPECT_TRUE(allocator.noteOn(67, Priority::Sequencer,
+                               Allocator::StealingPolicy::MRU, &stolen_note,
+                               &voice));
+  EXPECT_EQ(stolen_note, 64);
+  EXPECT_EQ(voice, 1);
+}
+
+TEST(VoiceAllocator, RetiresVoicesAboveReducedPolyphony) {
+  using Allocator = VoiceAllocator<8>;
+  Allocator allocator(4);
+  for (int note = 60; note < 64; ++note) {
+    allocator.noteOn(note, Priority::Sequencer, Allocator::StealingPolicy::LRU);
+  }
+  allocator.setNumVoices(2);
+  allocator.noteOff(63, Priority::Sequencer);  // voice 3 retired
+  allocator.noteOff(60, Priority::Sequencer);  // voice 0 back in the pool
+  allocator.noteOff(61, Priority::Sequencer);  // voice 1 back in the pool
+
+  int voice = Allocator::NO_VOICE;
+  allocator.noteOn(70, Priority::Sequencer, Allocator::StealingPolicy::LRU,
+                   nullptr, &voice);
+  EXPECT_EQ(voice, 0);
+  allocator.noteOn(71, Priority::Sequencer, Allocator::StealingPolicy::LRU,
+                   nullptr, &voice);
+  EXPECT_EQ(voice, 2);  // steals note 62 instead of growing past 2 voices
+  EXPECT_EQ(allocator.getNumActiveVoices(), 2u);
+}
+}  // namespace audio_plugin_test
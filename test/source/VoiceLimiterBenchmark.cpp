@@ -0,0 +1,172 @@
+#include <PolyArp/VoiceLimiter.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <vector>
+
+namespace audio_plugin_test {
+namespace {
+using Sequencer::Priority;
+using Sequencer::VoiceLimiter;
+using StealingPolicy = VoiceLimiter::StealingPolicy;
+
+// the std::deque implementation VoiceLimiter replaced, noteOn/noteOff only
+class DequeVoiceLimiter {
+public:
+  explicit DequeVoiceLimiter(size_t numVoices) : numVoices_(numVoices) {}
+
+  bool noteOn(int noteNumber,
+              Priority priority,
+              StealingPolicy policy,
+              int* stolenNote) {
+    auto result = std::find_if(
+        lru_.begin(), lru_.end(),
+        [noteNumber](const auto& voice) { return voice.note == noteNumber; });
+    if (result != lru_.end()) {
+      if (result->priority <= priority) {
+        *stolenNote = noteNumber;
+        lru_.erase(result);
+        lru_.push_back({noteNumber, priority});
+        return true;
+      }
+      return false;
+    }
+
+    if (lru_.size() < numVoices_) {
+      lru_.push_back({noteNumber, priority});
+      return true;
+    }
+
+    result = lru_.end();
+    if (policy == StealingPolicy::LRU) {
+      result = std::find_if(
+          lru_.begin(), lru_.end(),
+          [priority](const auto& voice) { return voice.priority <= priority; });
+    } else {
+      int min_distance = 128;
+      for (auto it = lru_.begin(); it != lru_.end(); ++it) {
+        if (it->priority <= priority) {
+          int distance = std::abs(it->note - noteNumber);
+          if (distance < min_distance) {
+            min_distance = distance;
+            result = it;
+          }
+        }
+      }
+    }
+
+    if (result != lru_.end()) {
+      *stolenNote = result->note;
+      lru_.erase(result);
+      lru_.push_back({noteNumber, priority});
+      return true;
+    }
+    return false;
+  }
+
+  bool noteOff(int noteNumber, Priority priority) {
+    auto result = std::find_if(
+        lru_.begin(), lru_.end(),
+        [noteNumber](const auto& voice) { return voice.note == noteNumber; });
+    if (result == lru_.end() || result->priority > priority) {
+      return false;
+    }
+    lru_.erase(result);
+    return true;
+  }
+
+  std::vector<int> getActiveNotes() const {
+    std::vector<int> result;
+    for (const auto& voice : lru_) {
+      result.push_back(voice.note);
+    }
+    return result;
+  }
+
+private:
+  struct Voice {
+    int note;
+    Priority priority;
+  };
+
+  std::deque<Voice> lru_;
+  size_t numVoices_;
+};
+
+struct Operation {
+  bool isNoteOn;
+  int note;
+  Priority priority;
+  StealingPolicy policy;
+};
+
+// dense keyboard + sequencer traffic, roughly as many note ons as note offs
+std::vector<Operation> makeOperations(int count) {
+  std::vector<Operation> operations;
+  std::uint32_t state = 12345;
+  for (int i = 0; i < count; ++i) {
+    state = state * 1664525u + 1013904223u;
+    operations.push_back(
+        {(state >> 31) != 0, static_cast<int>((state >> 8) % 128),
+         (state >> 20) % 4 == 0 ? Priority::Keyboard : Priority::Sequencer,
+         (state >> 24) % 8 == 0 ? StealingPolicy::LRU
+                                : StealingPolicy::Closest});
+  }
+  return operations;
+}
+
+template <typename Limiter>
+std::int64_t run(Limiter& limiter, const std::vector<Operation>& operations) {
+  std::int64_t checksum = 0;
+  for (const auto& operation : operations) {
+    if (operation.isNoteOn) {
+      int stolen_note = -1;
+      checksum += limiter.noteOn(operation.note, operation.priority,
+                                 operation.policy, &stolen_note);
+      checksum += stolen_note;
+    } else {
+      checksum += limiter.noteOff(operation.note, operation.priority);
+    }
+  }
+  for (int note : limiter.getActiveNotes()) {
+    checksum = checksum * 131 + note;
+  }
+  return checksum;
+}
+
+template <typename Limiter>
+double measureNanosecondsPerOperation(size_t numVoices,
+                                      const std::vector<Operation>& operations,
+                                      std::int64_t& checksum) {
+  Limiter limiter(numVoices);
+  auto start = std::chrono::steady_clock::now();
+  checksum = run(limiter, operations);
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         static_cast<double>(operations.size());
+}
+}  // namespace
+
+TEST(VoiceLimiterBenchmark, TenVoicesAndBypass) {
+  auto operations = makeOperations(1 << 20);
+
+  for (size_t num_voices : {10u, 127u}) {
+    std::int64_t deque_checksum = 0;
+    std::int64_t limiter_checksum = 0;
+    double deque_ns = measureNanosecondsPerOperation<DequeVoiceLimiter>(
+        num_voices, operations, deque_checksum);
+    double limiter_ns = measureNanosecondsPerOperation<VoiceLimiter>(
+        num_voices, operations, limiter_checksum);
+
+    EXPECT_EQ(deque_checksum, limiter_checksum);
+    std::printf(
+        "%3zu voices: std::deque %6.1f ns/op, VoiceLimiter %5.1f ns/op "
+        "(x%.1f)\n",
+        num_voices, deque_ns, limiter_ns, deque_ns / limiter_ns);
+  }
+}
+}  // namespace audio_plugin_test